@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace qtgl {
+
+/*
+堆分配计数, 以 QTGL_COUNT_ALLOCATIONS 构建时启用, 用于确认稳定状态下每帧没有堆分配:
+  - alloccount.cpp 替换全局 operator new, 计数标准容器、Qt 对象等经由 new 的分配
+  - Eigen 的动态矩阵直接调用 malloc, 不经过 operator new: 此时开启 EIGEN_RUNTIME_NO_MALLOC 并保持
+    "禁止分配" (见 define.hpp), Eigen 每次分配前的断言由 eigenAssert 改为计数, 其余断言照常中止;
+    这同时启用了 Eigen 的全部断言, 计数构建比普通构建慢
+未启用时 count 恒为 0. 本文件须在 <Eigen/Dense> 之前包含
+*/
+class GLAllocationCounter {
+ public:
+#ifdef QTGL_COUNT_ALLOCATIONS
+  constexpr static bool enabled = true;
+#else
+  constexpr static bool enabled = false;
+#endif
+
+  // 程序启动以来的堆分配次数
+  static uint64_t count() { return counter().load(std::memory_order_relaxed); }
+  static void add() { counter().fetch_add(1, std::memory_order_relaxed); }
+
+  static void eigenAssert(bool ok, const char* expr, const char* file, int line) {
+    if (ok) return;
+    if (std::strstr(expr, "is_malloc_allowed()")) {
+      add();
+      return;
+    }
+    std::fprintf(stderr, "%s:%d: Eigen assertion failed: %s\n", file, line, expr);
+    std::abort();
+  }
+
+ private:
+  static std::atomic<uint64_t>& counter() {
+    static std::atomic<uint64_t> n{0};
+    return n;
+  }
+};
+
+}  // namespace qtgl
+
+#ifdef QTGL_COUNT_ALLOCATIONS
+#ifndef EIGEN_RUNTIME_NO_MALLOC
+#define EIGEN_RUNTIME_NO_MALLOC
+#endif
+#define eigen_assert(x) \
+  ::qtgl::GLAllocationCounter::eigenAssert(static_cast<bool>(x), #x, __FILE__, __LINE__)
+#endif
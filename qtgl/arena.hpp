@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace qtgl {
+
+/*
+帧内存池: 只在一帧内使用的临时数据 (绘制顺序、存活的簇等) 从这里线性分配, 帧结束时 reset 一次性丢弃
+  - 分配只移动游标, 释放是空操作; reset 只把游标移回第一块, 为 O(1)
+  - 内存块在帧之间保留: 当前块用尽时进入下一块, 没有下一块时才向堆申请 (容量加倍),
+    经过最初几帧后稳定状态下不再有堆分配
+  - reset 之后此前分配的内存全部失效, 使用者须保证其生命周期不超过一帧
+*/
+class GLFrameArena {
+ private:
+  struct Block {
+    std::unique_ptr<unsigned char[]> data;
+    size_t size;
+  };
+  std::vector<Block> blocks;
+  size_t current = 0;  // 当前块
+  size_t offset = 0;   // 当前块中已使用的字节数
+  size_t used = 0;     // 本帧已分配的字节数
+  size_t initialSize;
+
+ public:
+  explicit GLFrameArena(size_t initialSize = 64 * 1024) : initialSize(initialSize) {}
+  GLFrameArena(const GLFrameArena&) = delete;
+  GLFrameArena& operator=(const GLFrameArena&) = delete;
+
+  void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+    while (true) {
+      if (current < blocks.size()) {
+        Block& block = blocks[current];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        uintptr_t aligned = (base + offset + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        if (aligned + bytes <= base + block.size) {
+          offset = aligned + bytes - base;
+          used += bytes;
+          return reinterpret_cast<void*>(aligned);
+        }
+        if (current + 1 < blocks.size()) {
+          ++current;
+          offset = 0;
+          continue;
+        }
+      }
+      size_t size = blocks.empty() ? initialSize : blocks.back().size * 2;
+      while (size < bytes + alignment) size *= 2;
+      blocks.push_back({std::unique_ptr<unsigned char[]>(new unsigned char[size]), size});
+      current = blocks.size() - 1;
+      offset = 0;
+    }
+  }
+
+  // 丢弃本帧的全部分配, 保留内存块
+  void reset() {
+    current = 0;
+    offset = 0;
+    used = 0;
+  }
+
+  size_t usedBytes() const { return used; }
+  size_t capacity() const {
+    size_t total = 0;
+    for (const Block& block : blocks) total += block.size;
+    return total;
+  }
+};
+
+// 从 GLFrameArena 分配的标准库分配器, deallocate 为空操作
+template <typename T>
+class GLArenaAllocator {
+ public:
+  using value_type = T;
+  GLFrameArena* arena;
+
+  explicit GLArenaAllocator(GLFrameArena& arena) : arena(&arena) {}
+  template <typename U>
+  GLArenaAllocator(const GLArenaAllocator<U>& other) : arena(other.arena) {}
+
+  T* allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+  void deallocate(T*, size_t) {}
+
+  template <typename U>
+  bool operator==(const GLArenaAllocator<U>& other) const {
+    return arena == other.arena;
+  }
+  template <typename U>
+  bool operator!=(const GLArenaAllocator<U>& other) const {
+    return arena != other.arena;
+  }
+};
+
+// 一帧内有效的临时数组
+template <typename T>
+using GLFrameVector = std::vector<T, GLArenaAllocator<T>>;
+
+}  // namespace qtgl
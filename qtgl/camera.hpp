@@ -12,45 +12,45 @@ Roll : Roll
 */
 class GLCamera {
  private:
-  double pos_x = 0;
-  double pos_y = 0;
-  double pos_z = 0;
-  double heading = 0;
-  double pitch = 0;
-  double roll = 0;
+  Scalar pos_x = 0;
+  Scalar pos_y = 0;
+  Scalar pos_z = 0;
+  Scalar heading = 0;
+  Scalar pitch = 0;
+  Scalar roll = 0;
 
  public:
   GLCamera() : pos_x(0), pos_y(0), pos_z(0), heading(0), pitch(0), roll(0) {}
-  GLCamera(double pos_x, double pos_y, double pos_z, double heading, double pitch, double roll)
+  GLCamera(Scalar pos_x, Scalar pos_y, Scalar pos_z, Scalar heading, Scalar pitch, Scalar roll)
       : pos_x(pos_x), pos_y(pos_y), pos_z(pos_z), heading(heading), pitch(pitch), roll(roll) {}
-  void setPosition(double x, double y, double z) {
+  void setPosition(Scalar x, Scalar y, Scalar z) {
     this->pos_x = x;
     this->pos_y = y;
     this->pos_z = z;
   }
-  void setPosture(double heading, double pitch, double roll) {
+  void setPosture(Scalar heading, Scalar pitch, Scalar roll) {
     this->heading = heading;
     this->pitch = pitch;
     this->roll = roll;
   }
-  void setPosX(double x) { this->pos_x = x; }
-  void setPosY(double y) { this->pos_y = y; }
-  void setPosZ(double z) { this->pos_z = z; }
-  void setHeading(double heading) { this->heading = heading; }
-  void setPitch(double pitch) { this->pitch = pitch; }
-  void setRoll(double roll) { this->roll = roll; }
-  double getPosX() const { return this->pos_x; }
-  double getPosY() const { return this->pos_y; }
-  double getPosZ() const { return this->pos_z; }
-  double getHeading() const { return this->heading; }
-  double getPitch() const { return this->pitch; }
-  double getRool() const { return this->roll; }
+  void setPosX(Scalar x) { this->pos_x = x; }
+  void setPosY(Scalar y) { this->pos_y = y; }
+  void setPosZ(Scalar z) { this->pos_z = z; }
+  void setHeading(Scalar heading) { this->heading = heading; }
+  void setPitch(Scalar pitch) { this->pitch = pitch; }
+  void setRoll(Scalar roll) { this->roll = roll; }
+  Scalar getPosX() const { return this->pos_x; }
+  Scalar getPosY() const { return this->pos_y; }
+  Scalar getPosZ() const { return this->pos_z; }
+  Scalar getHeading() const { return this->heading; }
+  Scalar getPitch() const { return this->pitch; }
+  Scalar getRool() const { return this->roll; }
   Vertice getPositionVertice() { return {pos_x, pos_y, pos_z, 1}; }
 
-  void lookAt(double fx, double fy, double fz, double tx, double ty, double tz) {
+  void lookAt(Scalar fx, Scalar fy, Scalar fz, Scalar tx, Scalar ty, Scalar tz) {
     // https://stackoverflow.com/a/33790309
     // TODO how to set z axis up
-    Eigen::Vector3d d(tx - fx, ty - fy, tz - fz);
+    Vector3 d(tx - fx, ty - fy, tz - fz);
     d.normalize();
     this->pitch = asinf(-d[1]);
     this->heading = atan2f(d[0], d[2]);
@@ -58,16 +58,11 @@ class GLCamera {
     this->setPosition(fx, fy, fz);
   }
 
-  Eigen::Matrix4d viewMatrix() {
-    Eigen::Matrix4d eyeMtx = Eigen::Matrix4d::Identity();
-    Vertices rotateMtx = static_cast<Vertices>(eyeMtx);
-    rotateMtx = AffineUtils::rotate_y(rotateMtx, -heading);
-    rotateMtx = AffineUtils::rotate_x(rotateMtx, -pitch);
-    rotateMtx = AffineUtils::rotate_z(rotateMtx, -roll);
-    Vertices translateMtx = static_cast<Vertices>(eyeMtx);
-    translateMtx = AffineUtils::translate(translateMtx, -pos_x, -pos_y, -pos_z);
-    Eigen::Matrix4d viewMtx =
-        static_cast<Eigen::Matrix4d>(translateMtx) * static_cast<Eigen::Matrix4d>(rotateMtx);
+  // 固定大小的矩阵直接相乘, 不经过动态大小的 Vertices, 每帧调用不分配内存
+  Matrix4 viewMatrix() {
+    Matrix4 rotateMtx = AffineUtils::rotateYMtx(-heading) * AffineUtils::rotateXMtx(-pitch) *
+                        AffineUtils::rotateZMtx(-roll);
+    Matrix4 viewMtx = AffineUtils::translateMtx(-pos_x, -pos_y, -pos_z) * rotateMtx;
     return viewMtx;
   }
 };
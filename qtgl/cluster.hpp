@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "define.hpp"
+#include "material.hpp"
+
+namespace qtgl {
+
+/*
+三角形簇 (meshlet): 组内连续的一段三角形, 附带模型坐标系下的包围球与法线锥
+  - 法线锥: 簇内所有三角形的朝外法线都落在以 coneAxis 为轴、半角为 acos(coneCos) 的锥内;
+    coneCos <= 0 (半角不小于 90 度) 时不做背面剔除
+  - 包围球与法线锥都在模型坐标系下, 剔除时把视点与视锥变换到模型坐标系,
+    对仿射变换 (含非均匀缩放) 都成立
+*/
+struct GLCluster {
+  int begin;  // 三角形范围 [begin, begin + count)
+  int count;
+  MaterialId material;
+  Vector3 center;
+  Scalar radius;
+  Vector3 coneAxis;
+  Scalar coneCos;
+  Scalar coneSin;
+};
+
+/*
+簇的划分与剔除
+  - 划分: 按三角形的现有顺序 (GLMeshOptimizer 重排后空间上连续) 贪心切分, 每簇至多 MAX_TRIANGLES 个
+    三角形、MAX_VERTICES 个不同顶点, 不跨越材质段
+  - 剔除: 包围球完全在视锥某个面外侧, 或 (透视投影下) 簇内三角形全部背向视点时, 整簇跳过
+三角形的朝外方向由其顶点法线之和确定, 与着色使用的法线一致, 不依赖 OBJ 的绕序
+*/
+class GLClusterCuller {
+ private:
+  Vector4 planes[5];  // 模型坐标系下的视锥面, (p, 1) 与之点积为到该面的距离, 非负在内侧
+  Vector3 eye;
+  bool coneCulling = false;
+
+ public:
+  constexpr static int MAX_TRIANGLES = 124;
+  constexpr static int MAX_VERTICES = 64;
+
+  /*
+  将 [begin, end) 范围内 (材质相同) 的三角形切分为簇并追加到 clusters;
+  position(i) / normal(i) 返回模型坐标系下第 i 个顶点的位置与法线
+  */
+  template <typename Position, typename NormalAt>
+  static void build(const Indices3& indices, int begin, int end, MaterialId material,
+                    Position position, NormalAt normal, std::vector<GLCluster>& clusters) {
+    std::vector<int> verts;
+    verts.reserve(MAX_VERTICES + 3);
+    int start = begin;
+    for (int t = begin; t < end; ++t) {
+      int fresh[3], added = 0;
+      for (int k = 0; k < 3; ++k) {
+        int v = indices(t, k);
+        if (std::find(verts.begin(), verts.end(), v) == verts.end() &&
+            std::find(fresh, fresh + added, v) == fresh + added) {
+          fresh[added++] = v;
+        }
+      }
+      if (t > start && (t - start == MAX_TRIANGLES ||
+                        verts.size() + added > static_cast<size_t>(MAX_VERTICES))) {
+        clusters.push_back(bounds(indices, start, t, material, position, normal));
+        verts.clear();
+        start = t;
+        added = 0;
+        for (int k = 0; k < 3; ++k) {
+          int v = indices(t, k);
+          if (std::find(fresh, fresh + added, v) == fresh + added) fresh[added++] = v;
+        }
+      }
+      verts.insert(verts.end(), fresh, fresh + added);
+    }
+    if (end > start) clusters.push_back(bounds(indices, start, end, material, position, normal));
+  }
+
+  template <typename Position, typename NormalAt>
+  static GLCluster bounds(const Indices3& indices, int begin, int end, MaterialId material,
+                          Position position, NormalAt normal) {
+    GLCluster c;
+    c.begin = begin;
+    c.count = end - begin;
+    c.material = material;
+
+    // 包围球取包围盒中心, 半径为到最远顶点的距离
+    AlignedBox3 box;
+    for (int t = begin; t < end; ++t) {
+      for (int k = 0; k < 3; ++k) box.extend(position(indices(t, k)));
+    }
+    c.center = box.center();
+    c.radius = 0;
+    for (int t = begin; t < end; ++t) {
+      for (int k = 0; k < 3; ++k) {
+        c.radius = std::max(c.radius, (position(indices(t, k)) - c.center).norm());
+      }
+    }
+
+    // 法线锥: 轴取单位面法线的平均方向, 半角取与轴的最大夹角
+    std::vector<Vector3> faceNormals;
+    faceNormals.reserve(end - begin);
+    Vector3 sum = Vector3::Zero();
+    for (int t = begin; t < end; ++t) {
+      Vector3 p0 = position(indices(t, 0));
+      Vector3 n = (position(indices(t, 1)) - p0).cross(position(indices(t, 2)) - p0);
+      Scalar len = n.norm();
+      if (!(len > 0)) continue;  // 退化三角形不覆盖任何像素
+      n /= len;
+      Vector3 shading = normal(indices(t, 0)) + normal(indices(t, 1)) + normal(indices(t, 2));
+      if (n.dot(shading) < 0) n = -n;
+      faceNormals.push_back(n);
+      sum += n;
+    }
+    c.coneAxis = Vector3::UnitZ();
+    c.coneCos = -1;
+    c.coneSin = 0;
+    Scalar len = sum.norm();
+    if (len > 0 && !faceNormals.empty()) {
+      c.coneAxis = sum / len;
+      c.coneCos = 1;
+      for (const Vector3& n : faceNormals) c.coneCos = std::min(c.coneCos, n.dot(c.coneAxis));
+      c.coneSin = std::sqrt(std::max<Scalar>(0, 1 - c.coneCos * c.coneCos));
+    }
+    return c;
+  }
+
+  /*
+  screenMtx: 模型坐标 -> 屏幕齐次坐标 (模型矩阵 * 视图 * 投影 * 视口); modelEye: 模型坐标系下的视点,
+  为空时 (正射投影) 不做背面剔除
+  */
+  GLClusterCuller(const Matrix4& screenMtx, Scalar width, Scalar height, const Vector3* modelEye) {
+    Vector4 x = screenMtx.col(0), y = screenMtx.col(1), w = screenMtx.col(3);
+    planes[0] = x;
+    planes[1] = width * w - x;
+    planes[2] = y;
+    planes[3] = height * w - y;
+    planes[4] = w;
+    for (Vector4& p : planes) {
+      Scalar len = p.head<3>().norm();
+      if (len > 0) p /= len;
+    }
+    if (modelEye) {
+      eye = *modelEye;
+      coneCulling = true;
+    }
+  }
+
+  bool visible(const GLCluster& c) const {
+    Vector4 center(c.center[0], c.center[1], c.center[2], 1);
+    for (const Vector4& p : planes) {
+      if (p.dot(center) < -c.radius) return false;
+    }
+    if (!coneCulling || c.coneCos <= 0) return true;
+    // 球内任一点 p 与锥内任一法线 n 都满足 dot(n, p - eye) > 0 时整簇背向视点:
+    // 充分条件为 |w| * cos(phi + theta) > radius, w = center - eye, phi 为 w 与轴的夹角
+    Vector3 v = c.center - eye;
+    Scalar dist = v.norm();
+    if (dist <= c.radius) return true;
+    Scalar cosPhi = v.dot(c.coneAxis) / dist;
+    Scalar sinPhi = std::sqrt(std::max<Scalar>(0, 1 - cosPhi * cosPhi));
+    return dist * (cosPhi * c.coneCos - sinPhi * c.coneSin) <= c.radius;
+  }
+};
+
+}  // namespace qtgl
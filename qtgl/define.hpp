@@ -1,5 +1,6 @@
 #pragma once
 
+#include "alloccount.hpp"  // 须在 Eigen 之前
 #include <Eigen/Dense>
 #include <limits>
 #include <random>
@@ -7,16 +8,44 @@
 
 namespace qtgl {
 
-using Vertice = Eigen::Vector4d;
-using Vertices = Eigen::Matrix<double, Eigen::Dynamic, 4>;
+#ifdef QTGL_COUNT_ALLOCATIONS
+// 让 Eigen 的每次堆分配都经过断言, 由 GLAllocationCounter 计数
+inline const bool eigenAllocationsCounted = (Eigen::internal::set_is_malloc_allowed(false), true);
+#endif
+
+/*
+几何与着色计算的标量类型: 默认 double; 以 QTGL_USE_FLOAT 构建时为 float,
+顶点数据与变换的内存占用减半, SIMD 每条指令处理的分量加倍. 需要高精度的离线渲染使用默认的 double
+*/
+#ifdef QTGL_USE_FLOAT
+using Scalar = float;
+#else
+using Scalar = double;
+#endif
+using Vector2 = Eigen::Matrix<Scalar, 2, 1>;
+using Vector3 = Eigen::Matrix<Scalar, 3, 1>;
+using Vector4 = Eigen::Matrix<Scalar, 4, 1>;
+using RowVector2 = Eigen::Matrix<Scalar, 1, 2>;
+using RowVector3 = Eigen::Matrix<Scalar, 1, 3>;
+using RowVector4 = Eigen::Matrix<Scalar, 1, 4>;
+using Matrix3 = Eigen::Matrix<Scalar, 3, 3>;
+using Matrix4 = Eigen::Matrix<Scalar, 4, 4>;
+using AlignedBox3 = Eigen::AlignedBox<Scalar, 3>;
+
+/*
+顶点属性与索引按行优先存储: 每个顶点 (或每个面) 的各分量连续存放,
+光栅化按索引取一个顶点时只读取一段连续内存 (double 时位置 32 字节), 而不是分散在各列中的 4 个元素
+*/
+using Vertice = Vector4;
+using Vertices = Eigen::Matrix<Scalar, Eigen::Dynamic, 4, Eigen::RowMajor>;
 using Index3 = Eigen::Vector3i;
-using Indices3 = Eigen::Matrix<int, Eigen::Dynamic, 3>;
-using Normal = Eigen::Vector3d;
-using Normals = Eigen::Matrix<double, Eigen::Dynamic, 3>;
+using Indices3 = Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor>;
+using Normal = Vector3;
+using Normals = Eigen::Matrix<Scalar, Eigen::Dynamic, 3, Eigen::RowMajor>;
 using NormIndex = Eigen::Vector3i;
-using NormIndices = Eigen::Matrix<int, Eigen::Dynamic, 3>;
-using TexCoord = Eigen::Vector2d;
-using TexCoords = Eigen::Matrix<double, Eigen::Dynamic, 2>;
+using NormIndices = Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor>;
+using TexCoord = Vector2;
+using TexCoords = Eigen::Matrix<Scalar, Eigen::Dynamic, 2, Eigen::RowMajor>;
 
 struct Color {
   short R;
@@ -31,13 +60,13 @@ struct Color {
   }
 };
 
-using Color01 = Eigen::Vector4d;
+using Color01 = Vector4;
 
 struct Color01Utils {
-  static double red(Color01& c) { return c[0]; }
-  static double green(Color01& c) { return c[1]; }
-  static double blue(Color01& c) { return c[2]; }
-  static double alpha(Color01& c) { return c[3]; }
+  static Scalar red(Color01& c) { return c[0]; }
+  static Scalar green(Color01& c) { return c[1]; }
+  static Scalar blue(Color01& c) { return c[2]; }
+  static Scalar alpha(Color01& c) { return c[3]; }
   static Color01 clamp(Color01& c) {
     Color01 r;
     r[0] = MathUtils::limit(c[0], 0, 1);
@@ -50,21 +79,21 @@ struct Color01Utils {
 
 class Triangle {
  private:
-  double f_alpha, f_beta, f_gamma;
-  double _x0, _y0, _z0, _x1, _y1, _z1, _x2, _y2, _z2;
-  double f01(double x, double y) {
+  Scalar f_alpha, f_beta, f_gamma;
+  Scalar _x0, _y0, _z0, _x1, _y1, _z1, _x2, _y2, _z2;
+  Scalar f01(Scalar x, Scalar y) {
     return (_y0 - _y1) * x + (_x1 - _x0) * y + _x0 * _y1 - _x1 * _y0;
   }
-  double f12(double x, double y) {
+  Scalar f12(Scalar x, Scalar y) {
     return (_y1 - _y2) * x + (_x2 - _x1) * y + _x1 * _y2 - _x2 * _y1;
   }
-  double f20(double x, double y) {
+  Scalar f20(Scalar x, Scalar y) {
     return (_y2 - _y0) * x + (_x0 - _x2) * y + _x2 * _y0 - _x0 * _y2;
   }
 
  public:
-  Triangle(double x0, double y0, double z0, double x1, double y1, double z1, double x2, double y2,
-           double z2)
+  Triangle(Scalar x0, Scalar y0, Scalar z0, Scalar x1, Scalar y1, Scalar z1, Scalar x2, Scalar y2,
+           Scalar z2)
       : _x0(x0), _y0(y0), _z0(z0), _x1(x1), _y1(y1), _z1(z1), _x2(x2), _y2(y2), _z2(z2) {
     f_alpha = f12(x0, y0);
     f_beta = f20(x1, y1);
@@ -85,25 +114,25 @@ class Triangle {
     f_gamma = f01(_x2, _y2);
   }
 
-  double x0() const { return _x0; }
-  double y0() const { return _y0; }
-  double z0() const { return _z0; }
-  double x1() const { return _x1; }
-  double y1() const { return _y1; }
-  double z1() const { return _z1; }
-  double x2() const { return _x2; }
-  double y2() const { return _y2; }
-  double z2() const { return _z2; }
+  Scalar x0() const { return _x0; }
+  Scalar y0() const { return _y0; }
+  Scalar z0() const { return _z0; }
+  Scalar x1() const { return _x1; }
+  Scalar y1() const { return _y1; }
+  Scalar z1() const { return _z1; }
+  Scalar x2() const { return _x2; }
+  Scalar y2() const { return _y2; }
+  Scalar z2() const { return _z2; }
 
   // 重心坐标
   struct BarycentricCoordnates {
-    double alpha;
-    double beta;
-    double gamma;
+    Scalar alpha;
+    Scalar beta;
+    Scalar gamma;
   };
 
   // 求解重心坐标
-  BarycentricCoordnates resovleBarycentricCoordnates(double x, double y) {
+  BarycentricCoordnates resovleBarycentricCoordnates(Scalar x, Scalar y) {
     BarycentricCoordnates coord;
     coord.alpha = f12(x, y) / f_alpha;
     coord.beta = f20(x, y) / f_beta;
@@ -121,18 +150,34 @@ class Triangle2 {
   Normal n0, n1, n2;
   TexCoord t0, t1, t2;
   bool hastexture = false;
-  double f_alpha, f_beta, f_gamma;
-  double f01(double x, double y) {
+  Scalar f_alpha, f_beta, f_gamma;
+  Scalar f01(Scalar x, Scalar y) {
     return (hy0() - hy1()) * x + (hx1() - hx0()) * y + hx0() * hy1() - hx1() * hy0();
   }
-  double f12(double x, double y) {
+  Scalar f12(Scalar x, Scalar y) {
     return (hy1() - hy2()) * x + (hx2() - hx1()) * y + hx1() * hy2() - hx2() * hy1();
   }
-  double f20(double x, double y) {
+  Scalar f20(Scalar x, Scalar y) {
     return (hy2() - hy0()) * x + (hx0() - hx2()) * y + hx2() * hy0() - hx0() * hy2();
   }
 
  public:
+  // 只有位置, 用于深度预渲染; 重心坐标与深度的计算和带属性的三角形完全相同
+  Triangle2(const Vertice& p0, const Vertice& p1, const Vertice& p2) {
+    this->p0 = p0;
+    this->p1 = p1;
+    this->p2 = p2;
+
+    this->hp0 = p0 / p0[3];
+    this->hp1 = p1 / p1[3];
+    this->hp2 = p2 / p2[3];
+
+    f_alpha = f12(hx0(), hy0());
+    f_beta = f20(hx1(), hy1());
+    f_gamma = f01(hx2(), hy2());
+
+    hastexture = false;
+  }
   Triangle2(Vertice& p0, Vertice& p1, Vertice& p2, Normal& n0, Normal& n1, Normal& n2) {
     this->p0 = p0;
     this->p1 = p1;
@@ -177,17 +222,17 @@ class Triangle2 {
     hastexture = true;
   }
 
-  inline double hx0() const { return hp0[0]; }
-  inline double hy0() const { return hp0[1]; }
-  inline double hz0() const { return hp0[2]; }
+  inline Scalar hx0() const { return hp0[0]; }
+  inline Scalar hy0() const { return hp0[1]; }
+  inline Scalar hz0() const { return hp0[2]; }
 
-  inline double hx1() const { return hp1[0]; }
-  inline double hy1() const { return hp1[1]; }
-  inline double hz1() const { return hp1[2]; }
+  inline Scalar hx1() const { return hp1[0]; }
+  inline Scalar hy1() const { return hp1[1]; }
+  inline Scalar hz1() const { return hp1[2]; }
 
-  inline double hx2() const { return hp2[0]; }
-  inline double hy2() const { return hp2[1]; }
-  inline double hz2() const { return hp2[2]; }
+  inline Scalar hx2() const { return hp2[0]; }
+  inline Scalar hy2() const { return hp2[1]; }
+  inline Scalar hz2() const { return hp2[2]; }
 
   Normal& getNormal0() { return n0; }
   Normal& getNormal1() { return n1; }
@@ -199,19 +244,19 @@ class Triangle2 {
   TexCoord& getTexCoord1() { return t1; }
   TexCoord& getTexCoord2() { return t2; }
 
-  double w0() const { return p0[3]; }
-  double w1() const { return p1[3]; }
-  double w2() const { return p2[3]; }
+  Scalar w0() const { return p0[3]; }
+  Scalar w1() const { return p1[3]; }
+  Scalar w2() const { return p2[3]; }
 
   // 重心坐标
   struct BarycentricCoordnates {
-    double alpha;
-    double beta;
-    double gamma;
+    Scalar alpha;
+    Scalar beta;
+    Scalar gamma;
   };
 
   // 求解重心坐标 
-  BarycentricCoordnates resovleBarycentricCoordnates(double x, double y) {
+  BarycentricCoordnates resovleBarycentricCoordnates(Scalar x, Scalar y) {
     BarycentricCoordnates coord;
     coord.alpha = f12(x, y) / f_alpha;
     coord.beta = f20(x, y) / f_beta;
@@ -228,8 +273,8 @@ class Triangle2 {
 
 struct Fragment {
   Color01 color;
-  double depth;  // z-buffer
-  constexpr static double DEPTH_INF = std::numeric_limits<double>::max() / 2;
+  Scalar depth;  // z-buffer
+  constexpr static Scalar DEPTH_INF = std::numeric_limits<Scalar>::max() / 2;
   static Fragment init() { return {{255, 255, 255, 255}, DEPTH_INF}; }
 };
 
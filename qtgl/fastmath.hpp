@@ -0,0 +1,208 @@
+#pragma once
+
+#include "alloccount.hpp"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+/*
+着色热路径的数学函数分为两档:
+  EXACT - 直接使用 std::pow / std::sqrt 等标准库函数
+  FAST  - 使用下面 FastMath 中的近似实现
+编译期通过 QTGL_FAST_MATH=1 切换到 FAST 档, 默认为 EXACT 档.
+*/
+#ifndef QTGL_FAST_MATH
+#define QTGL_FAST_MATH 0
+#endif
+
+namespace qtgl {
+
+enum class MathTier { EXACT, FAST };
+
+constexpr MathTier kMathTier = QTGL_FAST_MATH ? MathTier::FAST : MathTier::EXACT;
+
+/*
+近似数学函数, 均不含数据相关分支, 可被编译器自动向量化.
+误差为在全部有效输入范围上测得的最大误差, 见 test/fastmath_test.cpp
+*/
+struct FastMath {
+  constexpr static double LN2 = 0.69314718055994530942;
+  constexpr static double LOG2E = 1.44269504088896340736;
+
+  inline static double fromBits(uint64_t u) {
+    double d;
+    std::memcpy(&d, &u, sizeof(d));
+    return d;
+  }
+  inline static uint64_t toBits(double d) {
+    uint64_t u;
+    std::memcpy(&u, &d, sizeof(u));
+    return u;
+  }
+
+  /*
+  2^x, x 截断至 [-1022, 1023]
+  x = i + f, f in [-0.5, 0.5], 2^f 使用 7 阶泰勒展开
+  最大相对误差 < 1e-8
+  */
+  inline static double exp2(double x) {
+    x = std::min(std::max(x, -1022.0), 1023.0);
+    double i = std::nearbyint(x);
+    double f = (x - i) * LN2;
+    double p = 1.0 / 5040;
+    p = p * f + 1.0 / 720;
+    p = p * f + 1.0 / 120;
+    p = p * f + 1.0 / 24;
+    p = p * f + 1.0 / 6;
+    p = p * f + 0.5;
+    p = p * f + 1.0;
+    p = p * f + 1.0;
+    return p * fromBits(static_cast<uint64_t>(static_cast<int64_t>(i) + 1023) << 52);
+  }
+
+  /*
+  log2(x), x > 0 且为规格化数
+  x = 2^e * m, m in [sqrt(0.5), sqrt(2)), log2(m) 使用 atanh 级数展开至 t^9
+  最大绝对误差 < 2e-9
+  */
+  inline static double log2(double x) {
+    uint64_t u = toBits(x);
+    int64_t e = static_cast<int64_t>((u >> 52) & 0x7ff) - 1023;
+    double m = fromBits((u & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+    // 将 m 由 [1, 2) 调整至 [sqrt(0.5), sqrt(2))
+    bool big = m > 1.41421356237309504880;
+    m = big ? m * 0.5 : m;
+    e = big ? e + 1 : e;
+    double t = (m - 1) / (m + 1);
+    double t2 = t * t;
+    double p = 1.0 / 9;
+    p = p * t2 + 1.0 / 7;
+    p = p * t2 + 1.0 / 5;
+    p = p * t2 + 1.0 / 3;
+    p = p * t2 + 1.0;
+    return static_cast<double>(e) + 2 * LOG2E * t * p;
+  }
+
+  // e^x, 最大相对误差 < 1e-8
+  inline static double exp(double x) { return exp2(x * LOG2E); }
+
+  // ln(x), 最大绝对误差 < 1e-9
+  inline static double log(double x) { return log2(x) * LN2; }
+
+  /*
+  x^y, x >= 0
+  x == 0 时返回 0 (y > 0) 或 1 (y == 0)
+  |y * log2(x)| <= 64 时最大相对误差 < 1e-7
+  */
+  inline static double pow(double x, double y) {
+    double r = exp2(y * log2(std::max(x, std::numeric_limits<double>::min())));
+    return x > 0 ? r : (y == 0 ? 1.0 : 0.0);
+  }
+
+  /*
+  1/sqrt(x), x > 0
+  位运算初值 + 2 次牛顿迭代
+  最大相对误差 < 5e-6
+  */
+  inline static double rsqrt(double x) {
+    double y = fromBits(0x5fe6eb50c7b537a9ULL - (toBits(x) >> 1));
+    double h = 0.5 * x;
+    y = y * (1.5 - h * y * y);
+    y = y * (1.5 - h * y * y);
+    return y;
+  }
+
+  // 批量版本, 便于编译器向量化
+  static void pow(const double* x, double y, double* out, int n) {
+    for (int i = 0; i < n; ++i) out[i] = pow(x[i], y);
+  }
+  static void rsqrt(const double* x, double* out, int n) {
+    for (int i = 0; i < n; ++i) out[i] = rsqrt(x[i]);
+  }
+};
+
+/*
+材质高光指数查找表: 预先计算 x^n, 查询时线性插值
+x^n < CUTOFF 的区间直接返回 0, 表只覆盖 [CUTOFF^(1/n), 1], 因此精度与 n 无关
+n >= 1 时最大绝对误差 <= max(CUTOFF, ln(CUTOFF)^2 / (8(N-1)^2)), N 为表大小
+  N = 1024 时即 CUTOFF = 1/1024, 低于 8 位颜色的量化步长 (1/255)
+*/
+class SpecularPowLUT {
+ private:
+  double exponent = 0;
+  double lo = 0;     // 表覆盖区间下界
+  double scale = 0;  // (N - 1) / (1 - lo)
+  std::vector<double> table;
+
+ public:
+  constexpr static int DEFAULT_SIZE = 1024;
+  constexpr static double CUTOFF = 1.0 / 1024;
+
+  SpecularPowLUT() = default;
+  SpecularPowLUT(double exponent, int size = DEFAULT_SIZE) : exponent(exponent), table(size) {
+    lo = exponent > 0 ? std::pow(CUTOFF, 1 / exponent) : 0;
+    scale = (size - 1) / (1 - lo);
+    for (int i = 0; i < size; ++i) {
+      table[i] = std::pow(lo + i / scale, exponent);
+    }
+  }
+
+  double getExponent() const { return exponent; }
+  bool empty() const { return table.empty(); }
+
+  // x 截断至 [0, 1]
+  inline double pow(double x) const {
+    double s = (std::min(x, 1.0) - lo) * scale;
+    int i = std::min(std::max(static_cast<int>(s), 0), static_cast<int>(table.size()) - 2);
+    double f = s - i;
+    double r = table[i] + f * (table[i + 1] - table[i]);
+    return s < 0 ? 0.0 : r;
+  }
+
+  void pow(const double* x, double* out, int n) const {
+    for (int i = 0; i < n; ++i) out[i] = pow(x[i]);
+  }
+};
+
+/*
+着色使用的数学函数, 按档位分派
+*/
+template <MathTier tier>
+struct ShadeMathT;
+
+template <>
+struct ShadeMathT<MathTier::EXACT> {
+  inline static double pow(double x, double y) { return std::pow(x, y); }
+  inline static double pow(const SpecularPowLUT& lut, double x) {
+    return std::pow(x, lut.getExponent());
+  }
+  inline static double rsqrt(double x) { return 1 / std::sqrt(x); }
+  inline static double exp(double x) { return std::exp(x); }
+  inline static double log(double x) { return std::log(x); }
+  template <typename Derived>
+  inline static typename Derived::PlainObject normalized(const Eigen::MatrixBase<Derived>& v) {
+    return v.normalized();
+  }
+};
+
+template <>
+struct ShadeMathT<MathTier::FAST> {
+  inline static double pow(double x, double y) { return FastMath::pow(x, y); }
+  inline static double pow(const SpecularPowLUT& lut, double x) { return lut.pow(x); }
+  inline static double rsqrt(double x) { return FastMath::rsqrt(x); }
+  inline static double exp(double x) { return FastMath::exp(x); }
+  inline static double log(double x) { return FastMath::log(x); }
+  template <typename Derived>
+  inline static typename Derived::PlainObject normalized(const Eigen::MatrixBase<Derived>& v) {
+    double n2 = v.squaredNorm();
+    return n2 > 0 ? (v * FastMath::rsqrt(n2)).eval() : v.eval();
+  }
+};
+
+using ShadeMath = ShadeMathT<kMathTier>;
+
+}  // namespace qtgl
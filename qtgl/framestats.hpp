@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace qtgl {
+
+// 一类几何单元 (物体 / 网格组 / 三角形) 在一帧内的剔除统计, submitted = culled + rasterized
+struct GLCullStats {
+  size_t submitted = 0;
+  size_t culled = 0;
+  size_t rasterized = 0;
+};
+
+/*
+一帧的管线统计, 由 GLScene::draw 清零并填写:
+  - 几何: 物体 (实例化网格的每个实例算一个物体) 按包围盒整体剔除; 网格组与三角形只统计未被整体
+    剔除的物体, 按簇剔除时簇内的三角形计为剔除, 屏幕外 (包围矩形为空) 的三角形在建立时剔除.
+    开启深度预渲染时只统计着色阶段
+  - 像素: pixelsTested 为落在三角形内、参与深度测试的像素, depthPassed 为通过测试的像素,
+    两者包括深度预渲染; shadedFragments 为着色次数, coveredPixels 为最终被覆盖的像素
+  - 以替身绘制的实例计为光栅化的物体, 不计入网格组与三角形
+*/
+struct GLFrameStats {
+  GLCullStats objects;
+  GLCullStats groups;
+  GLCullStats triangles;
+
+  size_t pixelsTested = 0;
+  size_t depthPassed = 0;
+  size_t shadedFragments = 0;
+  size_t coveredPixels = 0;
+  uint64_t textureSamples = 0;  // 读取纹理 mip 层的次数 (包括替身的离屏绘制), 三线性过滤读两层
+  uint64_t allocations = 0;     // 堆分配次数, 以 QTGL_COUNT_ALLOCATIONS 构建时有效
+
+  // 各阶段耗时 (毫秒); 按簇剔除的网格在光栅化时才变换顶点, 计入 rasterizeMs
+  double updateMs = 0;     // 场景层次
+  double clearMs = 0;      // 清空片元缓冲区
+  double sortMs = 0;       // 计算绘制顺序
+  double transformMs = 0;  // 顶点变换 (包括深度预渲染)
+  double rasterizeMs = 0;  // 光栅化与着色 (包括深度预渲染)
+  double resolveMs = 0;    // 片元写入图像并绘制到画布
+  double totalMs = 0;
+
+  // 平均每个被覆盖像素的着色次数, 1 为没有过度绘制
+  double overdraw() const {
+    return coveredPixels ? static_cast<double>(shadedFragments) / coveredPixels : 0;
+  }
+};
+
+/*
+最近 CAPACITY 帧的耗时 (毫秒), 环形存放, 用于绘制帧时间曲线与计算分位数; 不分配堆内存
+*/
+class GLFrameTimeHistory {
+ public:
+  constexpr static size_t CAPACITY = 240;
+
+ private:
+  std::array<double, CAPACITY> times{};
+  size_t next = 0;   // 下一帧写入的位置
+  size_t count = 0;  // 已记录的帧数, 不超过 CAPACITY
+
+ public:
+  void push(double ms) {
+    times[next] = ms;
+    next = (next + 1) % CAPACITY;
+    count = std::min(count + 1, CAPACITY);
+  }
+  void clear() { next = count = 0; }
+  size_t size() const { return count; }
+  // 第 i 帧, 0 为最早的一帧
+  double at(size_t i) const { return times[(next + CAPACITY - count + i) % CAPACITY]; }
+
+  // 分位数 (p 取 0 ~ 1), 取排序后第 ceil(p * n) 个值 (nearest-rank); 没有记录时为 0
+  double percentile(double p) const {
+    if (count == 0) return 0;
+    std::array<double, CAPACITY> sorted;
+    for (size_t i = 0; i < count; ++i) sorted[i] = at(i);
+    size_t rank = static_cast<size_t>(std::max(1.0, std::ceil(p * count)));
+    rank = std::min(rank, count);
+    std::nth_element(sorted.begin(), sorted.begin() + (rank - 1), sorted.begin() + count);
+    return sorted[rank - 1];
+  }
+  double max() const {
+    double m = 0;
+    for (size_t i = 0; i < count; ++i) m = std::max(m, at(i));
+    return m;
+  }
+};
+
+}  // namespace qtgl
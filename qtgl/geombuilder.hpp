@@ -0,0 +1,71 @@
+#pragma once
+
+#include "alloccount.hpp"
+#include <Eigen/Dense>
+#include <cstddef>
+#include <vector>
+
+namespace qtgl {
+
+/*
+逐行构建 Eigen::Matrix<Scalar, Dynamic, Cols, RowMajor> 的暂存区
+  - 数据按行连续存放在 std::vector 中, 追加按几何级数扩容 (均摊 O(1)), 也可按已知行数预留
+  - 构建完成后一次性拷入目标矩阵, 代替逐行 conservativeResize (每次都会重新分配并复制整个矩阵)
+*/
+template <typename Scalar, int Cols>
+class MatrixBuilder {
+  static_assert(Cols > 1, "MatrixBuilder requires at least two columns");
+
+ private:
+  std::vector<Scalar> data;
+
+ public:
+  // 与 define.hpp 中的几何类型一致, 按行优先存储, 构建时整块拷贝
+  using Matrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Cols, Eigen::RowMajor>;
+  using RowMajorMap = Eigen::Map<const Matrix>;
+
+  void reserve(size_t rows) { data.reserve(rows * Cols); }
+  void clear() { data.clear(); }
+  size_t rows() const { return data.size() / Cols; }
+  bool empty() const { return data.empty(); }
+
+  template <typename... T>
+  void push(T... values) {
+    static_assert(sizeof...(T) == Cols, "push expects one value per column");
+    (data.push_back(static_cast<Scalar>(values)), ...);
+  }
+
+  template <typename Derived>
+  void pushRow(const Eigen::MatrixBase<Derived>& row) {
+    for (int c = 0; c < Cols; ++c) data.push_back(static_cast<Scalar>(row(c)));
+  }
+
+  // 在末尾追加 rows 行 (值为 0) 并返回其可写视图, 供调用者从源数据逐行直接写入;
+  // 视图在下次追加之前有效
+  Eigen::Map<Matrix> appendRows(size_t rows) {
+    size_t first = data.size();
+    data.resize(first + rows * Cols);
+    return Eigen::Map<Matrix>(data.data() + first, static_cast<Eigen::Index>(rows), Cols);
+  }
+
+  // 追加另一个暂存区的全部行
+  void append(const MatrixBuilder& other) {
+    data.insert(data.end(), other.data.begin(), other.data.end());
+  }
+
+  // 按行优先顺序的第 i 个元素
+  Scalar& operator[](size_t i) { return data[i]; }
+  const Scalar& operator[](size_t i) const { return data[i]; }
+
+  RowMajorMap view() const { return RowMajorMap(data.data(), static_cast<Eigen::Index>(rows()), Cols); }
+
+  Matrix build() const { return view(); }
+
+  // 写入 m 中从 firstRow 开始的行, m 须已分配足够的行数
+  template <typename Derived>
+  void copyTo(Eigen::MatrixBase<Derived>& m, Eigen::Index firstRow = 0) const {
+    m.middleRows(firstRow, static_cast<Eigen::Index>(rows())) = view();
+  }
+};
+
+}  // namespace qtgl
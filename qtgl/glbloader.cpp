@@ -0,0 +1,567 @@
+#include "glbloader.hpp"
+#include <QByteArray>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <set>
+#include "mappedfile.hpp"
+#include "texcache.hpp"
+
+namespace qtgl {
+
+namespace {
+
+constexpr uint32_t GLB_MAGIC = 0x46546C67;  // "glTF"
+constexpr uint32_t CHUNK_JSON = 0x4E4F534A;
+constexpr uint32_t CHUNK_BIN = 0x004E4942;
+
+enum ComponentType {
+  BYTE = 5120,
+  UNSIGNED_BYTE = 5121,
+  SHORT = 5122,
+  UNSIGNED_SHORT = 5123,
+  UNSIGNED_INT = 5125,
+  FLOAT = 5126
+};
+
+constexpr int MODE_TRIANGLES = 4;
+
+// 规范的默认材质在材质表中的名称, 不同于 materialName 为未命名材质生成的 "material<i>"
+const char* const DEFAULT_MATERIAL = "#default";
+
+// 访问器所指的数据: 首个元素地址、元素间距 (字节) 与元素数
+struct AccessorView {
+  const uint8_t* data = nullptr;
+  size_t stride = 0;
+  size_t count = 0;
+  int componentType = FLOAT;
+  int components = 1;
+  bool normalized = false;
+
+  // 第 i 个元素的第 c 个分量, 归一化整数按规范映射到 [0, 1] 或 [-1, 1]
+  double component(size_t i, int c) const {
+    const uint8_t* p = data + i * stride;
+    switch (componentType) {
+      case BYTE: {
+        int8_t v;
+        std::memcpy(&v, p + c, 1);
+        return normalized ? std::max(v / 127.0, -1.0) : v;
+      }
+      case UNSIGNED_BYTE:
+        return normalized ? p[c] / 255.0 : p[c];
+      case SHORT: {
+        int16_t v;
+        std::memcpy(&v, p + 2 * c, 2);
+        return normalized ? std::max(v / 32767.0, -1.0) : v;
+      }
+      case UNSIGNED_SHORT: {
+        uint16_t v;
+        std::memcpy(&v, p + 2 * c, 2);
+        return normalized ? v / 65535.0 : v;
+      }
+      case UNSIGNED_INT: {
+        uint32_t v;
+        std::memcpy(&v, p + 4 * c, 4);
+        return v;
+      }
+      default: {
+        float v;
+        std::memcpy(&v, p + 4 * c, 4);
+        return v;
+      }
+    }
+  }
+
+  // 以 Eigen::Map 直接读取 float 数据, 仅在 componentType 为 FLOAT 时有效
+  template <int N>
+  Eigen::Map<const Eigen::Matrix<float, Eigen::Dynamic, N, Eigen::RowMajor>, Eigen::Unaligned,
+             Eigen::OuterStride<>>
+  floats() const {
+    return {reinterpret_cast<const float*>(data), static_cast<Eigen::Index>(count), N,
+            Eigen::OuterStride<>(static_cast<Eigen::Index>(stride / sizeof(float)))};
+  }
+};
+
+int componentSize(int type) {
+  switch (type) {
+    case BYTE:
+    case UNSIGNED_BYTE:
+      return 1;
+    case SHORT:
+    case UNSIGNED_SHORT:
+      return 2;
+    default:
+      return 4;
+  }
+}
+
+int componentCount(const QString& type) {
+  std::string t = type.toStdString();
+  if (t == "SCALAR") return 1;
+  if (t == "VEC2") return 2;
+  if (t == "VEC3") return 3;
+  if (t == "VEC4") return 4;
+  if (t == "MAT4") return 16;
+  return 0;
+}
+
+class GlbDocument {
+ public:
+  std::string path;
+  std::string dirpath;
+  std::shared_ptr<MappedFile> file;
+  std::vector<std::shared_ptr<MappedFile>> externals;  // 外部 .bin 缓冲区
+  std::vector<std::pair<const uint8_t*, size_t>> buffers;
+  QJsonObject root;
+
+  QJsonArray array(const char* name) const { return root.value(name).toArray(); }
+
+  bool open(const std::string& path) {
+    this->path = path;
+    size_t slash = path.find_last_of("/\\");
+    dirpath = slash == std::string::npos ? "." : path.substr(0, slash);
+    file = MappedFile::open(path);
+    if (!file || file->size() < 20) return false;
+    const uint8_t* p = file->data();
+    uint32_t header[3];
+    std::memcpy(header, p, sizeof(header));
+    if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > file->size()) return false;
+    size_t end = header[2];
+
+    const uint8_t* bin = nullptr;
+    size_t binSize = 0;
+    bool hasJson = false;
+    for (size_t offset = 12; offset + 8 <= end;) {
+      uint32_t chunk[2];
+      std::memcpy(chunk, p + offset, sizeof(chunk));
+      offset += 8;
+      if (chunk[0] > end - offset) return false;
+      if (chunk[1] == CHUNK_JSON && !hasJson) {
+        QJsonParseError error;
+        QJsonDocument doc = QJsonDocument::fromJson(
+            QByteArray::fromRawData(reinterpret_cast<const char*>(p + offset), chunk[0]), &error);
+        if (error.error != QJsonParseError::NoError || !doc.isObject()) return false;
+        root = doc.object();
+        hasJson = true;
+      } else if (chunk[1] == CHUNK_BIN && !bin) {
+        bin = p + offset;
+        binSize = chunk[0];
+      }
+      offset += (chunk[0] + 3) & ~size_t(3);
+    }
+    if (!hasJson) return false;
+
+    QJsonArray bufs = array("buffers");
+    for (int i = 0; i < bufs.size(); ++i) {
+      QJsonObject b = bufs.at(i).toObject();
+      size_t byteLength = static_cast<size_t>(b.value("byteLength").toDouble());
+      if (!b.contains("uri")) {
+        // 没有 uri 的第 0 个缓冲区即 BIN 块
+        if (i != 0 || !bin || byteLength > binSize) return false;
+        buffers.emplace_back(bin, byteLength);
+        continue;
+      }
+      std::string uri = b.value("uri").toString().toStdString();
+      if (uri.compare(0, 5, "data:") == 0) {
+        std::cerr << "Error: data uri buffers are not supported in " << path << std::endl;
+        return false;
+      }
+      std::shared_ptr<MappedFile> ext = MappedFile::open(dirpath + "/" + uri);
+      if (!ext || ext->size() < byteLength) return false;
+      externals.push_back(ext);
+      buffers.emplace_back(ext->data(), byteLength);
+    }
+    return true;
+  }
+
+  // 缓冲视图的起始地址、长度与步长 (0 表示紧密排列)
+  bool bufferView(int index, const uint8_t*& data, size_t& length, size_t& stride) const {
+    QJsonArray views = array("bufferViews");
+    if (index < 0 || index >= views.size()) return false;
+    QJsonObject v = views.at(index).toObject();
+    int buffer = v.value("buffer").toInt(-1);
+    size_t offset = static_cast<size_t>(v.value("byteOffset").toDouble(0));
+    length = static_cast<size_t>(v.value("byteLength").toDouble(0));
+    stride = static_cast<size_t>(v.value("byteStride").toDouble(0));
+    if (buffer < 0 || buffer >= static_cast<int>(buffers.size()) ||
+        offset > buffers[buffer].second || length > buffers[buffer].second - offset) {
+      return false;
+    }
+    data = buffers[buffer].first + offset;
+    return true;
+  }
+
+  bool accessor(int index, AccessorView& view) const {
+    QJsonArray accessors = array("accessors");
+    if (index < 0 || index >= accessors.size()) return false;
+    QJsonObject a = accessors.at(index).toObject();
+    view.count = static_cast<size_t>(a.value("count").toDouble(0));
+    view.componentType = a.value("componentType").toInt(FLOAT);
+    view.components = componentCount(a.value("type").toString());
+    view.normalized = a.value("normalized").toBool(false);
+    if (view.components == 0 || a.contains("sparse") || !a.contains("bufferView")) return false;
+
+    const uint8_t* data;
+    size_t length, stride;
+    if (!bufferView(a.value("bufferView").toInt(-1), data, length, stride)) return false;
+    size_t offset = static_cast<size_t>(a.value("byteOffset").toDouble(0));
+    size_t elementSize = static_cast<size_t>(componentSize(view.componentType)) * view.components;
+    view.stride = stride ? stride : elementSize;
+    if (view.count > 0 &&
+        (offset > length || (view.count - 1) * view.stride + elementSize > length - offset)) {
+      return false;
+    }
+    view.data = data + offset;
+    return true;
+  }
+};
+
+// 节点的局部变换 (列向量约定)
+Matrix4 localMatrix(const QJsonObject& node) {
+  Matrix4 m = Matrix4::Identity();
+  if (node.contains("matrix")) {
+    QJsonArray a = node.value("matrix").toArray();
+    for (int i = 0; i < 16 && i < a.size(); ++i) m(i % 4, i / 4) = a.at(i).toDouble();
+    return m;
+  }
+  Vector3 t(0, 0, 0), s(1, 1, 1);
+  Eigen::Quaternion<Scalar> r(1, 0, 0, 0);
+  if (node.contains("translation")) {
+    QJsonArray a = node.value("translation").toArray();
+    t = Vector3(a.at(0).toDouble(), a.at(1).toDouble(), a.at(2).toDouble());
+  }
+  if (node.contains("rotation")) {
+    QJsonArray a = node.value("rotation").toArray();
+    r = Eigen::Quaternion<Scalar>(a.at(3).toDouble(), a.at(0).toDouble(), a.at(1).toDouble(),
+                                  a.at(2).toDouble());
+  }
+  if (node.contains("scale")) {
+    QJsonArray a = node.value("scale").toArray();
+    s = Vector3(a.at(0).toDouble(), a.at(1).toDouble(), a.at(2).toDouble());
+  }
+  m.block<3, 3>(0, 0) = r.normalized().toRotationMatrix() * s.asDiagonal();
+  m.block<3, 1>(0, 3) = t;
+  return m;
+}
+
+std::string materialName(const GlbDocument& doc, int index) {
+  if (index < 0) return "";
+  std::string name =
+      doc.array("materials").at(index).toObject().value("name").toString().toStdString();
+  return name.empty() ? "material" + std::to_string(index) : name;
+}
+
+std::shared_ptr<GLTexture> loadTexture(const GlbDocument& doc, int textureIndex) {
+  QJsonObject texture = doc.array("textures").at(textureIndex).toObject();
+  int source = texture.value("source").toInt(-1);
+  QJsonArray images = doc.array("images");
+  if (source < 0 || source >= images.size()) return nullptr;
+  QJsonObject image = images.at(source).toObject();
+  if (image.contains("uri")) {
+    std::string uri = image.value("uri").toString().toStdString();
+    if (uri.compare(0, 5, "data:") == 0) return nullptr;
+    return GLTextureCache::instance().acquire(doc.dirpath + "/" + uri);
+  }
+  const uint8_t* data;
+  size_t length, stride;
+  if (!doc.bufferView(image.value("bufferView").toInt(-1), data, length, stride)) return nullptr;
+  std::string key = GLTextureCache::canonicalPath(doc.path) + "#image" + std::to_string(source);
+  return GLTextureCache::instance().acquireEncoded(
+      key, std::make_shared<const std::vector<uint8_t>>(data, data + length));
+}
+
+/*
+金属度 / 粗糙度材质近似为 Blinn-Phong:
+  漫反射取基础色, 镜面反射率在 0.04 (电介质) 与基础色 (金属) 之间按金属度插值,
+  高光指数按 Ns = 2 / roughness^4 - 2 换算
+各项缺省时取规范的默认值, 因此空对象即规范的默认材质
+*/
+std::shared_ptr<GLMaterial> loadMaterial(const GlbDocument& doc, const QJsonObject& mtl) {
+  QJsonObject pbr = mtl.value("pbrMetallicRoughness").toObject();
+  Color01 base(1, 1, 1, 1);
+  if (pbr.contains("baseColorFactor")) {
+    QJsonArray a = pbr.value("baseColorFactor").toArray();
+    base = Color01(a.at(0).toDouble(), a.at(1).toDouble(), a.at(2).toDouble(), a.at(3).toDouble());
+  }
+  double metallic = pbr.value("metallicFactor").toDouble(1);
+  double roughness = std::max(pbr.value("roughnessFactor").toDouble(1), 0.03);
+  Color01 emissive(0, 0, 0, 1);
+  if (mtl.contains("emissiveFactor")) {
+    QJsonArray a = mtl.value("emissiveFactor").toArray();
+    emissive = Color01(a.at(0).toDouble(), a.at(1).toDouble(), a.at(2).toDouble(), 1);
+  }
+
+  std::shared_ptr<GLMaterial> material = std::make_shared<GLMaterial>();
+  Color01 dielectric(0.04, 0.04, 0.04, 1);
+  Color01 specular = (1 - metallic) * dielectric + metallic * base;
+  specular[3] = 1;
+  material->setAmbient({0, 0, 0, 1});
+  material->setDiffuse(base);
+  material->setSpecular(specular);
+  material->setEmmisive(emissive);
+  material->setSpecularHighlight(std::clamp(2 / std::pow(roughness, 4) - 2, 1.0, 1000.0));
+  material->setOpticalDensity(1.5);
+  material->setDissolve(base[3]);
+  material->setIllumination(IlluminationModel::LAMBERTIAN_BLINN_PHONG);
+  if (pbr.contains("baseColorTexture")) {
+    int texture = pbr.value("baseColorTexture").toObject().value("index").toInt(-1);
+    if (texture >= 0 && texture < doc.array("textures").size()) {
+      material->setDiffuseTexture(loadTexture(doc, texture));
+      material->setDiffuseTextureAlpha(1);  // 基础色纹理已包含颜色, 不再与 baseColorFactor 混合
+    }
+  }
+  return material;
+}
+
+// 各图元共享的加载状态
+struct LoadContext {
+  const GlbDocument& doc;
+  GLMeshBuilder& builder;
+  // (访问器, 节点) -> 该访问器写入构建器的起始行; 同一节点的图元共用访问器时只写入一次.
+  // 位置与法线烘焙了节点变换, 按节点区分; 纹理坐标与节点无关, 节点记为 -1
+  using AccessorBases = std::map<std::pair<int, int>, int>;
+  AccessorBases vertexBases, normalBases, texcoordBases;
+  MaterialId defaultMaterial = NO_MATERIAL;  // 首次需要时注册
+
+  LoadContext(const GlbDocument& doc, GLMeshBuilder& builder) : doc(doc), builder(builder) {}
+
+  // 没有材质或材质索引越界的图元使用规范的默认材质
+  MaterialId material(int index) {
+    if (index >= 0 && index < doc.array("materials").size()) {
+      return builder.materialId(materialName(doc, index));
+    }
+    if (defaultMaterial == NO_MATERIAL) {
+      builder.setMaterial(DEFAULT_MATERIAL, loadMaterial(doc, QJsonObject()));
+      defaultMaterial = builder.materialId(DEFAULT_MATERIAL);
+    }
+    return defaultMaterial;
+  }
+};
+
+// 逐行读取访问器的前 N 个分量并调用 f(i, row): float 经 Eigen::Map 在缓冲区中原地读取,
+// 其余按分量转换
+template <int N, typename F>
+void forEachRow(const AccessorView& view, F f) {
+  if (view.componentType == FLOAT) {
+    auto rows = view.floats<N>();
+    for (Eigen::Index i = 0; i < rows.rows(); ++i) f(i, rows.row(i).template cast<Scalar>());
+    return;
+  }
+  Eigen::Matrix<Scalar, 1, N> row;
+  for (size_t i = 0; i < view.count; ++i) {
+    for (int c = 0; c < N; ++c) row[c] = static_cast<Scalar>(view.component(i, c));
+    f(static_cast<Eigen::Index>(i), row);
+  }
+}
+
+// 为缺少法线的图元按面积加权计算顶点法线, 写入 normals (行数与 positions 相同)
+void computeNormals(const Eigen::Ref<const Vertices>& positions, const std::vector<int>& indices,
+                    Eigen::Map<Normals> normals) {
+  normals.setZero();
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    Vector3 p0 = positions.row(indices[i]).head<3>();
+    Vector3 p1 = positions.row(indices[i + 1]).head<3>();
+    Vector3 p2 = positions.row(indices[i + 2]).head<3>();
+    Vector3 n = (p1 - p0).cross(p2 - p0);
+    for (int k = 0; k < 3; ++k) normals.row(indices[i + k]) += n.transpose();
+  }
+  for (Eigen::Index i = 0; i < normals.rows(); ++i) {
+    Scalar len = normals.row(i).norm();
+    normals.row(i) = len > 0 ? Normal(normals.row(i) / len) : Normal(0, 0, 1);
+  }
+}
+
+/*
+将一个三角形图元追加到构建器:
+  位置与法线烘焙节点变换后直接写入构建器, 同一节点内已写入的访问器复用其起始行
+*/
+bool addPrimitive(LoadContext& ctx, const QJsonObject& primitive, int nodeIndex,
+                  const Matrix4& world, const std::string& groupName) {
+  const GlbDocument& doc = ctx.doc;
+  GLMeshBuilder& builder = ctx.builder;
+  if (primitive.value("mode").toInt(MODE_TRIANGLES) != MODE_TRIANGLES) return true;
+  QJsonObject attributes = primitive.value("attributes").toObject();
+  AccessorView position, normal, texcoord, index;
+  int positionId = attributes.value("POSITION").toInt(-1);
+  if (!doc.accessor(positionId, position) || position.components != 3) return false;
+  int normalId = attributes.value("NORMAL").toInt(-1);
+  bool hasNormal = attributes.contains("NORMAL") && doc.accessor(normalId, normal) &&
+                   normal.components == 3 && normal.count == position.count;
+  int texcoordId = attributes.value("TEXCOORD_0").toInt(-1);
+  bool hasTexcoord = attributes.contains("TEXCOORD_0") && doc.accessor(texcoordId, texcoord) &&
+                     texcoord.components == 2 && texcoord.count == position.count;
+
+  // 索引
+  std::vector<int> indices;
+  if (primitive.contains("indices")) {
+    if (!doc.accessor(primitive.value("indices").toInt(-1), index) || index.components != 1) {
+      return false;
+    }
+    indices.resize(index.count);
+    for (size_t i = 0; i < index.count; ++i) {
+      size_t v = static_cast<size_t>(index.component(i, 0));
+      if (v >= position.count) return false;
+      indices[i] = static_cast<int>(v);
+    }
+  } else {
+    indices.resize(position.count);
+    for (size_t i = 0; i < position.count; ++i) indices[i] = static_cast<int>(i);
+  }
+
+  // 位置: 烘焙节点变换 (行向量约定下 p' = p * A^T + t)
+  auto vertexSlot = ctx.vertexBases.emplace(std::make_pair(positionId, nodeIndex),
+                                            static_cast<int>(builder.vertexCount()));
+  int vertexBase = vertexSlot.first->second;
+  if (vertexSlot.second) {
+    Matrix3 linear = world.block<3, 3>(0, 0).transpose();
+    RowVector3 translation = world.block<3, 1>(0, 3).transpose();
+    Eigen::Map<Vertices> dst = builder.appendVertices(position.count);
+    forEachRow<3>(position, [&](Eigen::Index i, const auto& p) {
+      dst.row(i) << p * linear + translation, 1;
+    });
+  }
+
+  // 法线: 按法线矩阵变换; 缺少时按本图元的面生成, 不与其他图元共用
+  int normalBase;
+  if (hasNormal) {
+    auto normalSlot = ctx.normalBases.emplace(std::make_pair(normalId, nodeIndex),
+                                              static_cast<int>(builder.normalCount()));
+    normalBase = normalSlot.first->second;
+    if (normalSlot.second) {
+      Matrix3 normalMatrix = world.block<3, 3>(0, 0).inverse();  // 行向量右乘 (A^-1)^T 的转置
+      Eigen::Map<Normals> dst = builder.appendNormals(normal.count);
+      forEachRow<3>(normal, [&](Eigen::Index i, const auto& n) {
+        RowVector3 r = n * normalMatrix;
+        dst.row(i) = r.normalized();
+      });
+    }
+  } else {
+    normalBase = static_cast<int>(builder.normalCount());
+    computeNormals(builder.vertexView().middleRows(vertexBase, position.count), indices,
+                   builder.appendNormals(position.count));
+  }
+
+  // 纹理坐标: glTF 原点在左上角, 本项目 (同 OBJ) 在左下角
+  int texcoordBase = -1;
+  if (hasTexcoord) {
+    auto texcoordSlot = ctx.texcoordBases.emplace(std::make_pair(texcoordId, -1),
+                                                  static_cast<int>(builder.texcoordCount()));
+    texcoordBase = texcoordSlot.first->second;
+    if (texcoordSlot.second) {
+      Eigen::Map<TexCoords> dst = builder.appendTexCoords(texcoord.count);
+      forEachRow<2>(texcoord, [&](Eigen::Index i, const auto& t) { dst.row(i) << t[0], 1 - t[1]; });
+    }
+  }
+
+  MaterialId material = ctx.material(primitive.value("material").toInt(-1));
+  builder.reserveFaces(groupName, indices.size() / 3);
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    Index3 v(indices[i], indices[i + 1], indices[i + 2]);
+    builder.addIndex3(groupName, v + Index3::Constant(vertexBase));
+    builder.addNormIndex(groupName, v + Index3::Constant(normalBase));
+    Index3 t = hasTexcoord ? Index3(v + Index3::Constant(texcoordBase)) : Index3(-1, -1, -1);
+    builder.addTexRef(groupName, material, t);
+  }
+  return true;
+}
+
+bool addNode(LoadContext& ctx, int nodeIndex, const Matrix4& parent, int depth) {
+  QJsonArray nodes = ctx.doc.array("nodes");
+  if (nodeIndex < 0 || nodeIndex >= nodes.size() || depth > 64) return false;
+  QJsonObject node = nodes.at(nodeIndex).toObject();
+  Matrix4 world = parent * localMatrix(node);
+  if (node.contains("mesh")) {
+    int meshIndex = node.value("mesh").toInt(-1);
+    QJsonArray meshes = ctx.doc.array("meshes");
+    if (meshIndex < 0 || meshIndex >= meshes.size()) return false;
+    QJsonObject mesh = meshes.at(meshIndex).toObject();
+    std::string name = mesh.value("name").toString().toStdString();
+    if (name.empty()) name = "mesh" + std::to_string(meshIndex);
+    QJsonArray primitives = mesh.value("primitives").toArray();
+    for (int p = 0; p < primitives.size(); ++p) {
+      std::string groupName = name + "_" + std::to_string(nodeIndex) + "_" + std::to_string(p);
+      if (!addPrimitive(ctx, primitives.at(p).toObject(), nodeIndex, world, groupName)) {
+        return false;
+      }
+    }
+  }
+  QJsonArray children = node.value("children").toArray();
+  for (int i = 0; i < children.size(); ++i) {
+    if (!addNode(ctx, children.at(i).toInt(-1), world, depth + 1)) return false;
+  }
+  return true;
+}
+
+// 按各网格引用的不同访问器的元素数预留构建器 (被多个节点引用的网格按一次计)
+void reserveAttributes(const GlbDocument& doc, GLMeshBuilder& builder) {
+  std::set<int> positions, normals, texcoords;
+  QJsonArray meshes = doc.array("meshes");
+  for (int m = 0; m < meshes.size(); ++m) {
+    QJsonArray primitives = meshes.at(m).toObject().value("primitives").toArray();
+    for (int p = 0; p < primitives.size(); ++p) {
+      QJsonObject attributes = primitives.at(p).toObject().value("attributes").toObject();
+      positions.insert(attributes.value("POSITION").toInt(-1));
+      normals.insert(attributes.value("NORMAL").toInt(-1));
+      texcoords.insert(attributes.value("TEXCOORD_0").toInt(-1));
+    }
+  }
+  auto count = [&doc](const std::set<int>& ids) {
+    size_t n = 0;
+    AccessorView view;
+    for (int id : ids) n += doc.accessor(id, view) ? view.count : 0;
+    return n;
+  };
+  // 缺少法线的图元按位置数生成法线
+  builder.reserve(count(positions), std::max(count(normals), count(positions)), count(texcoords));
+}
+
+}  // namespace
+
+GLMesh* GlbLoader::load(const std::string& path) {
+  GlbDocument doc;
+  if (!doc.open(path)) {
+    std::cerr << "Error: cannot load glb " << path << std::endl;
+    return nullptr;
+  }
+
+  GLMeshBuilder builder;
+  QJsonArray materials = doc.array("materials");
+  for (int i = 0; i < materials.size(); ++i) {
+    builder.setMaterial(materialName(doc, i), loadMaterial(doc, materials.at(i).toObject()));
+  }
+  reserveAttributes(doc, builder);
+  LoadContext ctx(doc, builder);
+
+  // 默认场景的根节点; 没有场景时直接取所有网格
+  Matrix4 identity = Matrix4::Identity();
+  QJsonArray scenes = doc.array("scenes");
+  bool ok = true;
+  if (!scenes.isEmpty()) {
+    QJsonObject scene = scenes.at(doc.root.value("scene").toInt(0)).toObject();
+    QJsonArray roots = scene.value("nodes").toArray();
+    for (int i = 0; ok && i < roots.size(); ++i) {
+      ok = addNode(ctx, roots.at(i).toInt(-1), identity, 0);
+    }
+  } else {
+    QJsonArray meshes = doc.array("meshes");
+    for (int m = 0; ok && m < meshes.size(); ++m) {
+      QJsonArray primitives = meshes.at(m).toObject().value("primitives").toArray();
+      for (int p = 0; ok && p < primitives.size(); ++p) {
+        std::string groupName = "mesh" + std::to_string(m) + "_" + std::to_string(p);
+        ok = addPrimitive(ctx, primitives.at(p).toObject(), -1, identity, groupName);
+      }
+    }
+  }
+  if (!ok) {
+    std::cerr << "Error: invalid glb " << path << std::endl;
+    return nullptr;
+  }
+  return builder.build();
+}
+
+}  // namespace qtgl
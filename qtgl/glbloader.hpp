@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include "mesh.hpp"
+
+namespace qtgl {
+
+/*
+glTF 2.0 二进制 (.glb) 模型加载
+  - JSON 块由 QJsonDocument 解析, BIN 块及外部 .bin 缓冲区以内存映射方式访问
+  - 访问器以 Eigen::Map (带步长) 在映射的缓冲区中原地读取, 烘焙节点变换后逐行直接写入 GLMeshBuilder;
+    同一节点内多个图元共用的访问器只写入一次
+  - 默认场景中各节点的变换烘焙到顶点中, 每个图元 (primitive) 对应一个 GLMeshGroup
+  - 材质由金属度 / 粗糙度参数近似为 Blinn-Phong, 没有材质或材质索引越界的图元使用规范的默认材质;
+    内嵌图像经 GLTextureCache 进入纹理管线
+  - 只支持三角形图元, 其余图元被忽略
+*/
+class GlbLoader {
+ public:
+  // 读取 .glb 文件, 失败时返回 nullptr
+  static GLMesh* load(const std::string& path);
+};
+
+}  // namespace qtgl
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <vector>
+#include "mesh.hpp"
+#include "scene.hpp"
+
+namespace qtgl {
+
+// 一个视线方向上预先绘制的网格图像, 边长 resolution 的正方形覆盖包围球的直径
+struct GLImpostor {
+  Matrix3 linear;                // 绘制时世界矩阵的线性部分 (朝向与缩放)
+  Scalar roll = 0;               // 绘制时相机的滚转角, 图像的上方向随之旋转
+  std::vector<uint32_t> colors;  // 逐像素 RGBA8 颜色, 按行存放
+  std::vector<float> depths;     // 沿视线相对包围球中心的距离 (远为正), 未覆盖为无穷大
+  uint64_t lastUsed = 0;
+};
+
+/*
+远处物体的替身 (impostor) 缓存: 屏幕上投影半径不超过 maxPixelRadius 像素的网格不再光栅化三角形,
+而是以一张预先绘制的 RGBA + 深度图像 (一个与屏幕对齐的四边形) 代替
+  - 图像按世界坐标系下的视线方向分桶 (经纬度各按 bucketAngle 划分), 在桶中心方向上以平行投影
+    离屏绘制, 视线方向离开该桶之前一直复用; 朝向、缩放与相机滚转角相同的实例共用同一组图像
+  - 光照在绘制图像时烘焙, 光源改变后需 clear
+  - 深度逐像素保存, 与普通三角形正确地相互遮挡, 也参与深度预渲染
+  - 只在透视投影下使用
+*/
+class GLImpostorCache {
+ private:
+  Scalar maxPixelRadius = 0;  // 0 表示不使用替身
+  int resolution = 64;
+  Scalar bucketAngle = MathUtils::toRadians(4);
+  size_t maxImpostors = 256;
+  std::map<int, std::vector<GLImpostor>> buckets;
+  size_t count = 0;
+  uint64_t clock = 0;
+  Vertices scratchVertices;
+  Normals scratchNormals;
+
+  int rows() const { return static_cast<int>(std::ceil(MathUtils::PI / bucketAngle)); }
+  int columns() const { return static_cast<int>(std::ceil(2 * MathUtils::PI / bucketAngle)); }
+
+  // 单位方向所在的桶
+  int bucketOf(const Vector3& dir) const {
+    Scalar elevation = std::asin(std::max<Scalar>(-1, std::min<Scalar>(1, dir[1])));
+    Scalar azimuth = std::atan2(dir[2], dir[0]);
+    int row = static_cast<int>((elevation + MathUtils::PI / 2) / bucketAngle);
+    int column = static_cast<int>((azimuth + MathUtils::PI) / bucketAngle);
+    row = std::max(0, std::min(row, rows() - 1));
+    column = std::max(0, std::min(column, columns() - 1));
+    return row * columns() + column;
+  }
+
+  // 桶中心的单位方向
+  Vector3 bucketDirection(int bucket) const {
+    Scalar elevation = (bucket / columns() + 0.5) * bucketAngle - MathUtils::PI / 2;
+    Scalar azimuth = (bucket % columns() + 0.5) * bucketAngle - MathUtils::PI;
+    elevation = std::min<Scalar>(elevation, MathUtils::PI / 2);  // 最后一行可能越过极点
+    return Vector3(std::cos(elevation) * std::cos(azimuth), std::sin(elevation),
+                   std::cos(elevation) * std::sin(azimuth));
+  }
+
+  static uint32_t packColor(const Color01& color) {
+    uint32_t packed = 0;
+    for (int i = 0; i < 4; ++i) {
+      Scalar c = std::max<Scalar>(0, std::min<Scalar>(1, color[i]));
+      packed |= static_cast<uint32_t>(c * 255 + 0.5) << (8 * i);
+    }
+    return packed;
+  }
+  static Color01 unpackColor(uint32_t packed) {
+    Color01 color;
+    for (int i = 0; i < 4; ++i) color[i] = ((packed >> (8 * i)) & 0xFF) / Scalar(255);
+    return color;
+  }
+
+  void evict() {
+    while (count >= maxImpostors && count > 0) {
+      std::vector<GLImpostor>* oldestList = nullptr;
+      size_t oldest = 0;
+      for (auto& b : buckets) {
+        for (size_t i = 0; i < b.second.size(); ++i) {
+          if (!oldestList || b.second[i].lastUsed < (*oldestList)[oldest].lastUsed) {
+            oldestList = &b.second;
+            oldest = i;
+          }
+        }
+      }
+      oldestList->erase(oldestList->begin() + oldest);
+      --count;
+    }
+  }
+
+  /*
+  以平行投影沿 dir 绘制网格: 视图坐标系中以包围球中心为原点, [-radius, radius] 映射到整幅图像,
+  深度为视图 z 减去相机到中心的距离
+  */
+  void capture(GLScene& scene, const GLMesh& mesh, const Matrix4& world, const Vector3& dir,
+               const Vector3& center, Scalar radius, GLImpostor& impostor) {
+    Scalar distance = 2 * radius;
+    Vector3 eye = center - dir * distance;
+    GLCamera camera;
+    camera.lookAt(eye[0], eye[1], eye[2], center[0], center[1], center[2]);
+    camera.setRoll(impostor.roll);  // 与屏幕的上方向一致
+
+    Scalar half = resolution / 2.0;
+    Matrix4 ortho;
+    ortho << half / radius, 0, 0, 0,  //
+        0, half / radius, 0, 0,       //
+        0, 0, 1, 0,                   //
+        half, half, -distance, 1;     //
+    Matrix4 transform = camera.viewMatrix() * ortho;
+
+    Fragments target(resolution, std::vector<Fragment>(resolution, Fragment::init()));
+    scene.renderOffscreen(camera, transform, target, [&]() {
+      mesh.transformTo(world * transform, GLMesh::normalMatrix(world), scratchVertices,
+                       scratchNormals);
+      for (auto& g : mesh.getGroups()) {
+        g.second->rasterize(scene, scratchVertices, scratchNormals, nullptr);
+      }
+    });
+
+    impostor.colors.resize(resolution * resolution);
+    impostor.depths.resize(resolution * resolution);
+    for (int y = 0; y < resolution; ++y) {
+      for (int x = 0; x < resolution; ++x) {
+        const Fragment& fragment = target[y][x];
+        bool covered = fragment.depth < Fragment::DEPTH_INF;
+        impostor.colors[y * resolution + x] = packColor(fragment.color);
+        impostor.depths[y * resolution + x] =
+            covered ? static_cast<float>(fragment.depth) : std::numeric_limits<float>::infinity();
+      }
+    }
+  }
+
+ public:
+  /*
+  maxPixelRadius: 投影半径不超过该值 (像素) 时使用替身, 0 关闭;
+  resolution: 替身图像的边长, 不小于 2 * maxPixelRadius 时不会放大, 每张占 8 * resolution^2 字节;
+  bucketAngle: 方向桶的角度 (弧度), 视线方向变化超过该角度时重新绘制
+  */
+  void configure(Scalar maxPixelRadius, int resolution = 64,
+                 Scalar bucketAngle = MathUtils::toRadians(4)) {
+    this->maxPixelRadius = maxPixelRadius;
+    if (resolution != this->resolution || bucketAngle != this->bucketAngle) clear();
+    this->resolution = std::max(resolution, 2);
+    this->bucketAngle = bucketAngle > 0 ? bucketAngle : MathUtils::toRadians(4);
+  }
+  bool isEnabled() const { return maxPixelRadius > 0; }
+  void setMaxImpostors(size_t n) { maxImpostors = std::max<size_t>(n, 1); }
+  size_t size() const { return count; }
+  void clear() {
+    buckets.clear();
+    count = 0;
+  }
+
+  /*
+  网格以世界矩阵 world 足够小时以替身绘制到场景的片元缓冲区并返回 true, 否则返回 false (由调用者
+  正常光栅化); 该方向的替身不存在时先离屏绘制. 遵循场景当前的光栅化阶段
+  */
+  bool draw(GLScene& scene, const GLMesh& mesh, const Matrix4& world, const Color01* tint) {
+    GLProjection& projection = scene.getProjection();
+    const AlignedBox3& box = mesh.getBounds();
+    if (!isEnabled() || projection.mode != GLProjectionMode::PRESPECTIVE || box.isEmpty()) {
+      return false;
+    }
+    Matrix3 linear = world.block<3, 3>(0, 0);
+    RowVector4 c4 = RowVector4(box.center()[0], box.center()[1], box.center()[2], 1) * world;
+    Vector3 center = c4.head<3>().transpose();
+    Scalar radius = box.diagonal().norm() / 2 * linear.jacobiSvd().singularValues()[0];
+    Vector3 dir = center - scene.getCamera().getPositionVertice().head<3>();
+    Scalar distance = dir.norm();
+    if (!(radius > 0) || distance <= 2 * radius) return false;
+    dir /= distance;
+
+    const Matrix4& transform = scene.getTransformMatrix();
+    RowVector4 c = RowVector4(center[0], center[1], center[2], 1) * transform;
+    if (c[3] <= 0) return false;
+    Scalar pixelRadius = radius / c[3] * projection.projMatrix()(0, 0) * projection.width / 2;
+    if (pixelRadius > maxPixelRadius) return false;
+
+    int bucket = bucketOf(dir);
+    Scalar roll = scene.getCamera().getRool();
+    std::vector<GLImpostor>& list = buckets[bucket];
+    GLImpostor* impostor = nullptr;
+    for (GLImpostor& candidate : list) {
+      if (candidate.roll == roll && candidate.linear.isApprox(linear)) {
+        impostor = &candidate;
+        break;
+      }
+    }
+    if (!impostor) {
+      evict();  // 只删除桶中的元素, list 仍然有效
+      list.emplace_back();
+      impostor = &list.back();
+      impostor->linear = linear;
+      impostor->roll = roll;
+      ++count;
+      capture(scene, mesh, world, bucketDirection(bucket), center, radius, *impostor);
+    }
+    impostor->lastUsed = ++clock;
+
+    // 图像中的深度是视线方向上的距离, 在中心附近线性换算为屏幕深度
+    Vector3 behind = center + dir * radius;
+    RowVector4 b = RowVector4(behind[0], behind[1], behind[2], 1) * transform;
+    Scalar sx = c[0] / c[3], sy = c[1] / c[3], sz = c[2] / c[3];
+    Scalar slope = (b[2] / b[3] - sz) / radius;
+
+    Fragments& fragments = scene.getFragments();
+    int height = static_cast<int>(fragments.size());
+    int width = height > 0 ? static_cast<int>(fragments[0].size()) : 0;
+    int xmin = std::max(static_cast<int>(std::floor(sx - pixelRadius)), 0);
+    int xmax = std::min(static_cast<int>(std::ceil(sx + pixelRadius)), width - 1);
+    int ymin = std::max(static_cast<int>(std::floor(sy - pixelRadius)), 0);
+    int ymax = std::min(static_cast<int>(std::ceil(sy + pixelRadius)), height - 1);
+    GLRasterPass pass = scene.getRasterPass();
+    Scalar scale = resolution / (2 * pixelRadius);
+    size_t tested = 0;
+    size_t passed = 0;
+    size_t shaded = 0;
+    for (int y = ymin; y <= ymax; ++y) {
+      // 图像的像素在整数坐标处采样, 取最近的一个
+      int v = static_cast<int>(std::floor((y - sy) * scale + resolution / 2.0 + 0.5));
+      if (v < 0 || v >= resolution) continue;
+      for (int x = xmin; x <= xmax; ++x) {
+        int u = static_cast<int>(std::floor((x - sx) * scale + resolution / 2.0 + 0.5));
+        if (u < 0 || u >= resolution) continue;
+        float offset = impostor->depths[v * resolution + u];
+        if (std::isinf(offset)) continue;
+        Scalar depth = sz + offset * slope;
+        Fragment& fragment = fragments[y][x];
+        ++tested;
+        if (pass == GLRasterPass::DEPTH_ONLY) {
+          if (depth < fragment.depth) {
+            fragment.depth = depth;
+            ++passed;
+          }
+          continue;
+        }
+        if (pass == GLRasterPass::COLOR_EQUAL ? depth != fragment.depth : depth >= fragment.depth) {
+          continue;
+        }
+        ++passed;
+        ++shaded;
+        Color01 color = unpackColor(impostor->colors[v * resolution + u]);
+        fragment.color = tint ? Color01(color.cwiseProduct(*tint)) : color;
+        fragment.depth = depth;
+      }
+    }
+    GLFrameStats& stats = scene.getFrameStats();
+    stats.pixelsTested += tested;
+    stats.depthPassed += passed;
+    stats.shadedFragments += shaded;
+    return true;
+  }
+};
+
+}  // namespace qtgl
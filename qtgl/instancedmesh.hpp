@@ -0,0 +1,115 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "impostor.hpp"
+#include "mesh.hpp"
+#include "scene.hpp"
+
+namespace qtgl {
+
+// 实例化网格中的一个实例
+struct GLInstance {
+  Matrix4 modelMatrix = Matrix4::Identity();
+  Color01 tint = {1, 1, 1, 1};  // 与着色结果逐分量相乘, 白色即不改变
+  bool hidden = false;
+};
+
+/*
+几何实例化: 多个实例共享同一份网格 (顶点属性、各组索引与材质), 每个实例只有模型矩阵与色调
+  - 共享的网格视为不可变, 以 std::shared_ptr<const GLMesh> 持有, 可被多个实例化网格共用;
+    网格自身的模型矩阵不参与绘制
+  - 实例的世界矩阵为 instance.modelMatrix * modelMatrix, 后者 (GLObject 的模型矩阵) 整体移动所有实例
+  - 绘制时逐实例: 包围盒在视锥外的实例直接跳过; 模型矩阵与屏幕变换矩阵合并后每个顶点只乘一次,
+    法线只乘法线矩阵; 变换结果写入复用的暂存区, 实例之间不再分配内存
+  - 开启替身 (getImpostors().configure) 后, 投影足够小的实例以替身图像代替, 见 impostor.hpp
+  - clone 只复制实例表, 网格仍然共享
+网格需已按材质分段 (readFromObjFile、GLMeshBuilder 与 GlbLoader 得到的网格均已经过 GLMeshOptimizer)
+*/
+class GLInstancedMesh : public GLObject {
+ private:
+  std::shared_ptr<const GLMesh> mesh;
+  std::vector<GLInstance> instances;
+  Normals transformedNormals;  // 暂存区, 与 transfromedVertices 一起逐实例复用
+  size_t drawnInstances = 0;   // 最近一次绘制中未被剔除的实例数
+  size_t drawnImpostors = 0;   // 其中以替身绘制的实例数
+  GLImpostorCache impostors;
+
+ public:
+  explicit GLInstancedMesh(std::shared_ptr<const GLMesh> mesh) : mesh(std::move(mesh)) {}
+  // 接管 mesh
+  explicit GLInstancedMesh(GLMesh* mesh) : mesh(mesh) {}
+
+  const std::shared_ptr<const GLMesh>& getMesh() const { return mesh; }
+
+  size_t addInstance(const Matrix4& modelMatrix, const Color01& tint = {1, 1, 1, 1}) {
+    GLInstance instance;
+    instance.modelMatrix = modelMatrix;
+    instance.tint = tint;
+    instances.push_back(instance);
+    return instances.size() - 1;
+  }
+  GLInstance& getInstance(size_t i) { return instances[i]; }
+  std::vector<GLInstance>& getInstances() { return instances; }
+  size_t instanceCount() const { return instances.size(); }
+  size_t getDrawnInstances() const { return drawnInstances; }
+  size_t getDrawnImpostors() const { return drawnImpostors; }
+  GLImpostorCache& getImpostors() { return impostors; }
+
+  GLObject* clone() {
+    GLInstancedMesh* p = new GLInstancedMesh(mesh);
+    p->instances = instances;
+    p->modelMatrix = modelMatrix;
+    return p;
+  }
+
+  AlignedBox3 worldBounds() const {
+    AlignedBox3 box;
+    if (!mesh) return box;
+    for (const GLInstance& instance : instances) {
+      if (instance.hidden) continue;
+      box.extend(transformBounds(mesh->getBounds(), instance.modelMatrix * modelMatrix));
+    }
+    return box;
+  }
+
+  // 变换在 rasterize 中逐实例进行
+  void prepareTransform() {}
+  void transformVerticesWithMatrix(Matrix4& /*mtx*/) {}
+  void transformWithModelMatrix() {}
+  void draw(QPainter& /*painter*/) {}
+
+  void rasterize(GLScene& scene) {
+    drawnInstances = 0;
+    drawnImpostors = 0;
+    if (!mesh) return;
+    const Color01 white = {1, 1, 1, 1};
+    GLFrameStats& stats = scene.getFrameStats();
+    for (const GLInstance& instance : instances) {
+      if (instance.hidden) continue;
+      ++stats.objects.submitted;
+      Matrix4 world = instance.modelMatrix * modelMatrix;
+      Matrix4 screen = world * scene.getTransformMatrix();
+      if (!scene.boxInView(mesh->getBounds(), screen)) {
+        ++stats.objects.culled;
+        continue;
+      }
+      ++stats.objects.rasterized;
+      ++drawnInstances;
+      const Color01* tint = instance.tint == white ? nullptr : &instance.tint;
+      if (impostors.draw(scene, *mesh, world, tint)) {
+        ++drawnImpostors;
+        continue;
+      }
+      stats.groups.submitted += mesh->getGroups().size();
+      stats.groups.rasterized += mesh->getGroups().size();
+      mesh->transformTo(screen, GLMesh::normalMatrix(world), transfromedVertices,
+                        transformedNormals);
+      for (auto& g : mesh->getGroups()) {
+        g.second->rasterize(scene, transfromedVertices, transformedNormals, tint);
+      }
+    }
+  }
+};
+
+}  // namespace qtgl
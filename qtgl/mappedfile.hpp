@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace qtgl {
+
+/*
+只读内存映射文件, 析构时解除映射
+*/
+class MappedFile {
+ private:
+  const uint8_t* ptr = nullptr;
+  size_t length = 0;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#endif
+
+  MappedFile() = default;
+
+ public:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+#ifdef _WIN32
+    if (ptr) UnmapViewOfFile(ptr);
+    if (mapping) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+    if (ptr) munmap(const_cast<uint8_t*>(ptr), length);
+#endif
+  }
+
+  // 映射整个文件, 失败时返回空; 空文件映射成功但 data() 为 nullptr
+  static std::shared_ptr<MappedFile> open(const std::string& path) {
+    std::shared_ptr<MappedFile> m(new MappedFile);
+#ifdef _WIN32
+    m->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                          FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m->file == INVALID_HANDLE_VALUE) return nullptr;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m->file, &size)) return nullptr;
+    m->length = static_cast<size_t>(size.QuadPart);
+    if (m->length == 0) return m;
+    m->mapping = CreateFileMappingA(m->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m->mapping) return nullptr;
+    m->ptr = static_cast<const uint8_t*>(MapViewOfFile(m->mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m->ptr) return nullptr;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      ::close(fd);
+      return nullptr;
+    }
+    m->length = static_cast<size_t>(st.st_size);
+    if (m->length > 0) {
+      void* p = mmap(nullptr, m->length, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) {
+        ::close(fd);
+        return nullptr;
+      }
+      m->ptr = static_cast<const uint8_t*>(p);
+    }
+    ::close(fd);
+#endif
+    return m;
+  }
+
+  const uint8_t* data() const { return ptr; }
+  size_t size() const { return length; }
+};
+
+}  // namespace qtgl
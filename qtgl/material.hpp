@@ -1,7 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 #include "define.hpp"
+#include "fastmath.hpp"
 #include "texture.hpp"
 
 namespace qtgl {
@@ -22,31 +26,28 @@ class GLMaterial {
   double opticalDensity = 0;                                     // Ni
   double dissolve = 0;                                           // d
   IlluminationModel illumination = IlluminationModel::CONSTANT;  // illum
-  GLTexture* ambientTexture = nullptr;                           // map_Ka
-  GLTexture* diffuseTexture = nullptr;                           // map_Kd
+  std::shared_ptr<GLTexture> ambientTexture;                     // map_Ka
+  std::shared_ptr<GLTexture> diffuseTexture;                     // map_Kd
   double ambientTextureAlpha = 0.5;
   double diffuseTextureAlpha = 0.5;
+  SpecularPowLUT specularLUT;  // Ns 查找表, FAST 档着色使用
 
  public:
   GLMaterial() = default;
-  ~GLMaterial() {  // TODO: 设置纹理公共缓冲区
-    if (ambientTexture) {
-      delete ambientTexture;
-    }
-    if (diffuseTexture) {
-      delete diffuseTexture;
-    }
-  }
+  ~GLMaterial() = default;  // 纹理由 GLTextureCache 共享, 随最后一个句柄释放
   void setAmbient(Color01 color) { ambient = color; }
   void setDiffuse(Color01 color) { diffuse = color; }
   void setSpecular(Color01 color) { specular = color; }
   void setEmmisive(Color01 color) { emmisive = color; }
-  void setSpecularHighlight(double d) { specularHighlight = d; }
+  void setSpecularHighlight(double d) {
+    specularHighlight = d;
+    specularLUT = SpecularPowLUT(d);
+  }
   void setOpticalDensity(double d) { opticalDensity = d; }
   void setDissolve(double d) { dissolve = d; }
   void setIllumination(IlluminationModel model) { illumination = model; }
-  void setAmbientTexture(GLTexture* texture) { ambientTexture = texture; }
-  void setDiffuseTexture(GLTexture* texture) { diffuseTexture = texture; }
+  void setAmbientTexture(std::shared_ptr<GLTexture> texture) { ambientTexture = texture; }
+  void setDiffuseTexture(std::shared_ptr<GLTexture> texture) { diffuseTexture = texture; }
   void setAmbientTextureAlpha(double a) { ambientTextureAlpha = a; }
   void setDiffuseTextureAlpha(double a) { diffuseTextureAlpha = a; }
 
@@ -55,29 +56,76 @@ class GLMaterial {
   Color01 getSpecular() const { return specular; }
   Color01 getEmmisive() const { return emmisive; }
   double getSpecularHighlight() const { return specularHighlight; }
+  const SpecularPowLUT& getSpecularLUT() const { return specularLUT; }
   double getOpticalDensity() const { return opticalDensity; }
   double getDissolve() const { return dissolve; }
   IlluminationModel getIllumination() const { return illumination; }
-  GLTexture* getAmbientTexture() const { return ambientTexture; }
-  GLTexture* getDiffuseTexture() const { return diffuseTexture; }
+  GLTexture* getAmbientTexture() const { return ambientTexture.get(); }
+  GLTexture* getDiffuseTexture() const { return diffuseTexture.get(); }
   double getAmbientTextureAlpha() const { return ambientTextureAlpha; }
   double getDiffuseTextureAlpha() const { return diffuseTextureAlpha; }
 
-  Color01 getAmbient(TexCoord* coord) {
-    if (coord == nullptr || ambientTexture == nullptr) {
+  Color01 getAmbient(TexCoord* coord, TexCoordDerivs* derivs = nullptr) {
+    // 纹理尚未解码完成时以材质颜色占位
+    if (coord == nullptr || ambientTexture == nullptr || !ambientTexture->request()) {
       return ambient;
     }
-    return (1 - ambientTextureAlpha) * ambient +
-           ambientTextureAlpha * ambientTexture->sample(*coord);
+    Color01 t = derivs ? ambientTexture->sample(*coord, *derivs) : ambientTexture->sample(*coord);
+    return (1 - ambientTextureAlpha) * ambient + ambientTextureAlpha * t;
   }
 
-  Color01 getDiffuse(TexCoord* coord) {
-    if (coord == nullptr || diffuseTexture == nullptr) {
+  Color01 getDiffuse(TexCoord* coord, TexCoordDerivs* derivs = nullptr) {
+    if (coord == nullptr || diffuseTexture == nullptr || !diffuseTexture->request()) {
       return diffuse;
     }
-    return (1 - diffuseTextureAlpha) * diffuse +
-           diffuseTextureAlpha * diffuseTexture->sample(*coord);
+    Color01 t = derivs ? diffuseTexture->sample(*coord, *derivs) : diffuseTexture->sample(*coord);
+    return (1 - diffuseTextureAlpha) * diffuse + diffuseTextureAlpha * t;
+  }
+};
+
+// 网格内材质的紧凑编号, 每个三角形只存 2 字节
+using MaterialId = uint16_t;
+constexpr MaterialId NO_MATERIAL = 0xFFFF;
+
+/*
+材质名到 MaterialId 的驻留表, 编号按首次出现的顺序分配且不会改变
+  - 加载时由名称换得编号, 光栅化时按编号直接取材质, 不再做字符串查找
+  - 引用了但未定义的材质 (如 MTL 中缺失) 也占一个编号, 对应的材质为空
+*/
+class GLMaterialTable {
+ private:
+  std::vector<std::string> names;
+  std::vector<std::shared_ptr<GLMaterial>> materials;  // 副本间共享
+
+ public:
+  // 返回 name 的编号, 不存在时追加; 编号用尽时返回 NO_MATERIAL
+  MaterialId intern(const std::string& name) {
+    MaterialId id = find(name);
+    if (id != NO_MATERIAL || names.size() >= NO_MATERIAL) return id;
+    names.push_back(name);
+    materials.emplace_back();
+    return static_cast<MaterialId>(names.size() - 1);
+  }
+  MaterialId find(const std::string& name) const {
+    for (size_t i = 0; i < names.size(); ++i) {
+      if (names[i] == name) return static_cast<MaterialId>(i);
+    }
+    return NO_MATERIAL;
+  }
+  void set(const std::string& name, std::shared_ptr<GLMaterial> material) {
+    MaterialId id = intern(name);
+    if (id != NO_MATERIAL) materials[id] = std::move(material);
+  }
+  void set(MaterialId id, std::shared_ptr<GLMaterial> material) {
+    materials[id] = std::move(material);
+  }
+
+  size_t size() const { return names.size(); }
+  const std::string& name(MaterialId id) const { return names[id]; }
+  GLMaterial* get(MaterialId id) const {
+    return id < materials.size() ? materials[id].get() : nullptr;
   }
+  const std::shared_ptr<GLMaterial>& at(MaterialId id) const { return materials[id]; }
 };
 
 }  // namespace qtgl
\ No newline at end of file
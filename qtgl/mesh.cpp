@@ -1,103 +1,425 @@
 #include "mesh.hpp"
+#include "meshcache.hpp"
+#include "meshopt.hpp"
 
 namespace qtgl {
 
+namespace {
+const Color01 defaultFaceColors[3] = {GLMesh::defaultColor, GLMesh::defaultColor,
+                                      GLMesh::defaultColor};
+}
+
 void GLMeshGroup::addIndex3(Index3 idx) {
   addIndex3(idx, GLMesh::defaultColor, GLMesh::defaultColor, GLMesh::defaultColor);
 }
 
+void GLMeshGroup::addIndex3(Index3 idx, Color01 clr0, Color01 clr1, Color01 clr2) {
+  indices.conservativeResize(indices.rows() + 1, indices.cols());
+  indices.row(indices.rows() - 1) = idx;
+  bool uniform = clr0 == GLMesh::defaultColor && clr1 == GLMesh::defaultColor &&
+                 clr2 == GLMesh::defaultColor;
+  if (colors.empty() && uniform) return;
+  colors.resize((indices.rows() - 1) * 3, GLMesh::defaultColor);
+  colors.insert(colors.end(), {clr0, clr1, clr2});
+}
+
+const Color01* GLMeshGroup::faceColors(Eigen::Index i) const {
+  return colors.empty() ? defaultFaceColors : &colors[i * 3];
+}
+
+void GLMeshGroup::buildBatches() {
+  Eigen::Index faces = indices.rows();
+  if (texIndices.rows() < faces) {
+    Eigen::Index rows = texIndices.rows();
+    texIndices.conservativeResize(faces, 3);
+    texIndices.bottomRows(faces - rows).setConstant(-1);
+  }
+  materialIds.resize(faces, NO_MATERIAL);
+  batches.clear();
+  for (int i = 0; i < faces; ++i) {
+    if (batches.empty() || batches.back().material != materialIds[i]) {
+      batches.push_back({materialIds[i], i, 0});
+    }
+    ++batches.back().count;
+  }
+}
+
 void GLMeshGroup::rasterize(GLScene& scene) {
-  int n = indices.rows();
-  for (int i = 0; i < n; ++i) {
+  if (batches.empty() && indices.rows() > 0) buildBatches();
+  rasterize(scene, parent->getTransformedVertices(), parent->getTransformedNormals(), nullptr);
+}
+
+void GLMeshGroup::buildClusters() {
+  clusters.clear();
+  if (!parent->isWelded()) return;
+  auto position = [this](int i) { return parent->positionAt(i); };
+  auto normal = [this](int i) { return parent->normalAt(i); };
+  for (const MaterialBatch& batch : batches) {
+    GLClusterCuller::build(indices, batch.begin, batch.begin + batch.count, batch.material,
+                           position, normal, clusters);
+  }
+}
+
+void GLMeshGroup::rasterize(GLScene& scene, const Vertices& screenVertices, const Normals& normals,
+                            const Color01* tint) const {
+  for (const MaterialBatch& batch : batches) {
+    rasterizeRange(scene, screenVertices, normals, batch.begin, batch.begin + batch.count,
+                   parent->getMaterial(batch.material), tint);
+  }
+}
+
+void GLMeshGroup::rasterizeRange(GLScene& scene, const Vertices& screenVertices,
+                                 const Normals& normals, int begin, int end, GLMaterial* material,
+                                 const Color01* tint) const {
+  scene.getFrameStats().triangles.submitted += end - begin;
+  if (scene.getRasterPass() == GLRasterPass::DEPTH_ONLY) {
+    Fragments& fragments = scene.getFragments();
+    for (int i = begin; i < end; ++i) {
+      Triangle2 t(screenVertices.row(indices(i, 0)), screenVertices.row(indices(i, 1)),
+                  screenVertices.row(indices(i, 2)));
+      rasterizeTriangleDepth(fragments, t, scene.getFrameStats());
+    }
+    return;
+  }
+  bool welded = parent->isWelded();  // 焊接后法线与纹理坐标都使用面索引
+  for (int i = begin; i < end; ++i) {
     Index3 idx = indices.row(i);
-    NormIndex normIdx = normIndices.row(i);
-    TexRef ref = texrefs[i];
-    Vertice p0 = parent->getTransformedVertices().row(idx[0]);
-    Vertice p1 = parent->getTransformedVertices().row(idx[1]);
-    Vertice p2 = parent->getTransformedVertices().row(idx[2]);
-    Normal n0 = parent->getTransformedNormals().row(normIdx[0]).normalized();
-    Normal n1 = parent->getTransformedNormals().row(normIdx[1]).normalized();
-    Normal n2 = parent->getTransformedNormals().row(normIdx[2]).normalized();
-
-    GLMaterial* material = parent->getMaterial(ref.mtlname);
-
-    if (ref.indices[0] != -1 && ref.indices[1] != -1 && ref.indices[2] != -1) {
-      TexCoord t0 = parent->getTexCoords().row(ref.indices[0]);
-      TexCoord t1 = parent->getTexCoords().row(ref.indices[1]);
-      TexCoord t2 = parent->getTexCoords().row(ref.indices[2]);
+    NormIndex normIdx = welded ? idx : NormIndex(normIndices.row(i));
+    Vertice p0 = screenVertices.row(idx[0]);
+    Vertice p1 = screenVertices.row(idx[1]);
+    Vertice p2 = screenVertices.row(idx[2]);
+    // 变换时已单位化
+    Normal n0 = normals.row(normIdx[0]);
+    Normal n1 = normals.row(normIdx[1]);
+    Normal n2 = normals.row(normIdx[2]);
+
+    if (texIndices(i, 0) != -1 && texIndices(i, 1) != -1 && texIndices(i, 2) != -1) {
+      Index3 texIdx = welded ? idx : Index3(texIndices.row(i));
+      TexCoord t0 = parent->texCoordAt(texIdx[0]);
+      TexCoord t1 = parent->texCoordAt(texIdx[1]);
+      TexCoord t2 = parent->texCoordAt(texIdx[2]);
       Triangle2 t(p0, p1, p2, n0, n1, n2, t0, t1, t2);
-      std::vector<Color01> clrs = colors[i];
-      rasterizeTriangle(scene, t, clrs, material);
+      rasterizeTriangle(scene, t, faceColors(i), material, tint);
     } else {
       Triangle2 t(p0, p1, p2, n0, n1, n2);
-      std::vector<Color01> clrs = colors[i];
-      rasterizeTriangle(scene, t, clrs, material);
+      rasterizeTriangle(scene, t, faceColors(i), material, tint);
     }
   }
 }
 
-void GLMeshGroup::rasterizeTriangle(GLScene& scene, Triangle2& t, std::vector<Color01>& clrs,
-                                    GLMaterial* material) {
-  // mbr
-  int xmin = static_cast<int>(std::min(std::min(t.hx0(), t.hx1()), t.hx2()));
+/*
+以 2x2 像素块为单位光栅化: 块内 4 个像素都计算重心坐标及纹理坐标 (包括落在三角形外的辅助像素),
+相邻像素纹理坐标之差即为屏幕空间导数, 用于纹理的 mip 层级选择
+*/
+void GLMeshGroup::rasterizeTriangle(GLScene& scene, Triangle2& t, const Color01* clrs,
+                                    GLMaterial* material, const Color01* tint) const {
+  // mbr, 对齐到偶数坐标
+  int xmin = static_cast<int>(std::min(std::min(t.hx0(), t.hx1()), t.hx2())) & ~1;
   int xmax = static_cast<int>(std::max(std::max(t.hx0(), t.hx1()), t.hx2()));
-  int ymin = static_cast<int>(std::min(std::min(t.hy0(), t.hy1()), t.hy2()));
+  int ymin = static_cast<int>(std::min(std::min(t.hy0(), t.hy1()), t.hy2())) & ~1;
   int ymax = static_cast<int>(std::max(std::max(t.hy0(), t.hy1()), t.hy2()));
 
-  double depth;
+  Scalar depth;
   Color01 color;
-  Triangle2::BarycentricCoordnates coord;
+  Triangle2::BarycentricCoordnates coords[2][2];
+  bool covered[2][2];
+  TexCoord txtcoords[2][2];
+  TexCoordDerivs derivs;
   Fragments& fragments = scene.getFragments();
-  GLTexture* texture = material->getDiffuseTexture();
+  int height = static_cast<int>(fragments.size());
+  int width = height > 0 ? static_cast<int>(fragments[0].size()) : 0;
   IlluminationModel model = material->getIllumination();
+  bool textured = t.getHasTexture() && model != IlluminationModel::CONSTANT;
+  bool equalDepth = scene.getRasterPass() == GLRasterPass::COLOR_EQUAL;
+  GLFrameStats& stats = scene.getFrameStats();
+  size_t tested = 0;
+  size_t shaded = 0;
 
-  for (int x = xmin; x <= xmax; ++x) {
-    if (x < 0 || x >= fragments[0].size()) continue;
-    for (int y = ymin; y <= ymax; ++y) {
-      if (y < 0 || y >= fragments.size()) continue;
-      // Shade Fragment
+  ymin = std::max(ymin, 0);
+  xmin = std::max(xmin, 0);
+  ymax = std::min(ymax, height - 1);
+  xmax = std::min(xmax, width - 1);
+  if (xmin > xmax || ymin > ymax) {  // 在屏幕外
+    ++stats.triangles.culled;
+    return;
+  }
+  ++stats.triangles.rasterized;
 
-      coord = t.resovleBarycentricCoordnates(x, y);
-      if (coord.alpha >= 0 && coord.beta >= 0 && coord.gamma >= 0) {
-        depth = coord.alpha * t.hz0() + coord.beta * t.hz1() + coord.gamma * t.hz2();
-        if (depth < fragments[y][x].depth) {
-          // decide to shade
+  for (int qy = ymin; qy <= ymax; qy += 2) {
+    for (int qx = xmin; qx <= xmax; qx += 2) {
+      bool any = false;
+      for (int dy = 0; dy < 2; ++dy) {
+        for (int dx = 0; dx < 2; ++dx) {
+          Triangle2::BarycentricCoordnates& coord = coords[dy][dx];
+          coord = t.resovleBarycentricCoordnates(qx + dx, qy + dy);
+          covered[dy][dx] = coord.alpha >= 0 && coord.beta >= 0 && coord.gamma >= 0 &&
+                            qx + dx <= xmax && qy + dy <= ymax;
+          any = any || covered[dy][dx];
+        }
+      }
+      if (!any) continue;
 
+      if (textured) {
+        for (int dy = 0; dy < 2; ++dy) {
+          for (int dx = 0; dx < 2; ++dx) {
+            Triangle2::BarycentricCoordnates& coord = coords[dy][dx];
+            txtcoords[dy][dx] =
+                GLTexture::interpolateTexCoord(t, coord.alpha, coord.beta, coord.gamma);
+          }
+        }
+      }
+
+      for (int dy = 0; dy < 2; ++dy) {
+        for (int dx = 0; dx < 2; ++dx) {
+          if (!covered[dy][dx]) continue;
+          int x = qx + dx;
+          int y = qy + dy;
+          Triangle2::BarycentricCoordnates& coord = coords[dy][dx];
+          depth = coord.alpha * t.hz0() + coord.beta * t.hz1() + coord.gamma * t.hz2();
+          ++tested;
+          if (equalDepth ? depth != fragments[y][x].depth : depth >= fragments[y][x].depth) {
+            continue;
+          }
+          ++shaded;
+
+          // decide to shade
           if (model == IlluminationModel::CONSTANT) {
             color = material->getDiffuse();
           } else {
             GLShader* shader = scene.getShader(IlluminationModel::LAMBERTIAN_BLINN_PHONG);  // TODO
             Vertice screenPos(x, y, depth, 1);
             Vertice worldPos = scene.screenVerticeBackToWorldVertice(screenPos);
-            Normal uvNormal = (coord.alpha * t.getNormal0() + coord.beta * t.getNormal1() +
-                               coord.gamma * t.getNormal2())
-                                  .normalized();
-            Normal uvView =
-                (scene.getCamera().getPositionVertice().head(3) - worldPos.head(3)).normalized();
-            TexCoord txtcoord =
-                GLTexture::interpolateTexCoord(t, coord.alpha, coord.beta, coord.gamma);
-
-            color = shader->shade(scene.getLights(), scene.getAmbient(), material, worldPos,
-                                  uvNormal, uvView, &txtcoord);
+            Normal uvNormal = ShadeMath::normalized(coord.alpha * t.getNormal0() +
+                                                    coord.beta * t.getNormal1() +
+                                                    coord.gamma * t.getNormal2());
+            Normal uvView = ShadeMath::normalized(scene.getCamera().getPositionVertice().head(3) -
+                                                  worldPos.head(3));
+            if (textured) {
+              // 同行 / 同列相邻像素之差
+              derivs.dx = txtcoords[dy][1] - txtcoords[dy][0];
+              derivs.dy = txtcoords[1][dx] - txtcoords[0][dx];
+              color = shader->shade(scene.getLights(), scene.getAmbient(), material, worldPos,
+                                    uvNormal, uvView, &txtcoords[dy][dx], &derivs);
+            } else {
+              color = shader->shade(scene.getLights(), scene.getAmbient(), material, worldPos,
+                                    uvNormal, uvView, nullptr);
+            }
           }
 
+          if (tint) color = color.cwiseProduct(*tint);
           fragments[y][x].color = color;
           fragments[y][x].depth = depth;
         }
       }
     }
   }
+  stats.pixelsTested += tested;
+  stats.depthPassed += shaded;  // 通过深度测试的片元都着色
+  stats.shadedFragments += shaded;
+}
+
+/*
+与 rasterizeTriangle 逐像素使用相同的重心坐标与深度表达式, 得到的深度完全相同,
+着色阶段才能以相等判断片元是否可见
+*/
+void GLMeshGroup::rasterizeTriangleDepth(Fragments& fragments, Triangle2& t, GLFrameStats& stats) {
+  // 与 rasterizeTriangle 相同的 mbr, 保证遍历的像素集合一致
+  int xmin = static_cast<int>(std::min(std::min(t.hx0(), t.hx1()), t.hx2())) & ~1;
+  int xmax = static_cast<int>(std::max(std::max(t.hx0(), t.hx1()), t.hx2()));
+  int ymin = static_cast<int>(std::min(std::min(t.hy0(), t.hy1()), t.hy2())) & ~1;
+  int ymax = static_cast<int>(std::max(std::max(t.hy0(), t.hy1()), t.hy2()));
+  int height = static_cast<int>(fragments.size());
+  int width = height > 0 ? static_cast<int>(fragments[0].size()) : 0;
+  ymin = std::max(ymin, 0);
+  xmin = std::max(xmin, 0);
+  ymax = std::min(ymax, height - 1);
+  xmax = std::min(xmax, width - 1);
+  if (xmin > xmax || ymin > ymax) {
+    ++stats.triangles.culled;
+    return;
+  }
+  ++stats.triangles.rasterized;
+
+  size_t tested = 0;
+  size_t passed = 0;
+  for (int y = ymin; y <= ymax; ++y) {
+    for (int x = xmin; x <= xmax; ++x) {
+      Triangle2::BarycentricCoordnates coord = t.resovleBarycentricCoordnates(x, y);
+      if (coord.alpha < 0 || coord.beta < 0 || coord.gamma < 0) continue;
+      Scalar depth = coord.alpha * t.hz0() + coord.beta * t.hz1() + coord.gamma * t.hz2();
+      ++tested;
+      if (depth < fragments[y][x].depth) {
+        fragments[y][x].depth = depth;
+        ++passed;
+      }
+    }
+  }
+  stats.pixelsTested += tested;
+  stats.depthPassed += passed;
 }
 
 const Color01 GLMesh::defaultColor = {1, 1, 1, 1};
 const std::string GLMesh::defaultGroup = "default";
 
 void GLMesh::rasterize(GLScene& scene) {
+  if (clusterPending) {
+    rasterizeClusters(scene);
+    return;
+  }
+  GLFrameStats& stats = scene.getFrameStats();
+  ++stats.objects.submitted;
+  ++stats.objects.rasterized;
+  stats.groups.submitted += groups.size();
+  stats.groups.rasterized += groups.size();
   for (auto g : groups) {
     (g.second)->rasterize(scene);
   }
 }
 
+/*
+包围球、法线锥与视点都在模型坐标系下比较, 只需把视锥面与视点变换到模型坐标系;
+存活的簇引用的顶点按需变换 (与屏幕变换合并为一次矩阵乘法), 由 vertexStamps 保证每帧只变换一次
+*/
+void GLMesh::rasterizeClusters(GLScene& scene) {
+  clusterPending = false;
+  Matrix4 screenMtx = modelMatrix * pendingScreenMatrix;
+  GLFrameStats& stats = scene.getFrameStats();
+  ++stats.objects.submitted;
+  totalClusters = 0;
+  drawnClusters = 0;
+  if (!scene.boxInView(bounds, screenMtx)) {  // 整体在视锥外, 不必逐簇检查
+    ++stats.objects.culled;
+    return;
+  }
+  ++stats.objects.rasterized;
+  Matrix3 normalMtx = normalMatrix(modelMatrix);
+  GLProjection& projection = scene.getProjection();
+  bool perspective = projection.mode == GLProjectionMode::PRESPECTIVE;
+  RowVector4 eye = scene.getCamera().getPositionVertice().transpose() * modelMatrix.inverse();
+  Vector3 modelEye = eye.head<3>().transpose() / eye[3];
+  GLClusterCuller culler(screenMtx, projection.width, projection.height,
+                         perspective ? &modelEye : nullptr);
+
+  Eigen::Index n = vertexCount();
+  transfromedVertices.resize(n, 4);
+  transfromedNormals.resize(n, 3);
+  if (vertexStamps.size() != static_cast<size_t>(n) || ++frameStamp == 0) {
+    vertexStamps.assign(n, 0);
+    frameStamp = 1;
+  }
+  Matrix4 vertexMtx = isQuantized() ? Matrix4(quantizer.positionMatrix * screenMtx) : screenMtx;
+  auto transformVertex = [&](int v) {
+    if (isQuantized()) {
+      RowVector4 q(quantized(v, VertexQuantizer::PX), quantized(v, VertexQuantizer::PY),
+                   quantized(v, VertexQuantizer::PZ), 1);
+      transfromedVertices.row(v).noalias() = q * vertexMtx;
+      transfromedNormals.row(v).noalias() =
+          quantizer.direction(quantized, v).transpose() * normalMtx;
+    } else {
+      transfromedVertices.row(v).noalias() = vertices.row(v) * vertexMtx;
+      transfromedNormals.row(v).noalias() = normals.row(v) * normalMtx;
+    }
+    Scalar len = transfromedNormals.row(v).norm();
+    if (len > 0) transfromedNormals.row(v) /= len;
+  };
+
+  for (auto& g : groups) totalClusters += g.second->clusters.size();
+  GLFrameVector<VisibleCluster> visibleClusters{
+      GLArenaAllocator<VisibleCluster>(scene.getFrameArena())};
+  visibleClusters.reserve(totalClusters);
+  for (auto& g : groups) {
+    size_t visibleBefore = visibleClusters.size();
+    for (const GLCluster& c : g.second->clusters) {
+      if (!culler.visible(c)) {
+        stats.triangles.submitted += c.count;
+        stats.triangles.culled += c.count;
+        continue;
+      }
+      visibleClusters.push_back({(c.center - modelEye).norm() - c.radius, g.second, &c});
+    }
+    ++stats.groups.submitted;
+    if (visibleClusters.size() == visibleBefore) {
+      ++stats.groups.culled;
+    } else {
+      ++stats.groups.rasterized;
+    }
+  }
+  drawnClusters = visibleClusters.size();
+  if (scene.isFrontToBack()) {
+    std::sort(visibleClusters.begin(), visibleClusters.end(),
+              [](const VisibleCluster& a, const VisibleCluster& b) {
+                return a.distance < b.distance;
+              });
+  }
+
+  for (const VisibleCluster& visible : visibleClusters) {
+    const GLMeshGroup& group = *visible.group;
+    const GLCluster& c = *visible.cluster;
+    for (int t = c.begin; t < c.begin + c.count; ++t) {
+      for (int k = 0; k < 3; ++k) {
+        int v = group.indices(t, k);
+        if (vertexStamps[v] == frameStamp) continue;
+        vertexStamps[v] = frameStamp;
+        transformVertex(v);
+      }
+    }
+    group.rasterizeRange(scene, transfromedVertices, transfromedNormals, c.begin, c.begin + c.count,
+                         getMaterial(c.material), nullptr);
+  }
+}
+
+void GLMesh::quantize() {
+  if (isQuantized() || vertices.rows() == 0) return;
+  // 编码按行把顶点、法线与纹理坐标配对, 只对焊接后的网格成立
+  GLMeshOptimizer::optimize(*this);
+  if (!welded) return;
+  quantizer = VertexQuantizer::fit(vertices, texcoords);
+  quantized = quantizer.encode(vertices, normals, texcoords);
+  vertices.resize(0, 4);
+  normals.resize(0, 3);
+  if (quantizer.uvQuantized) texcoords.resize(0, 2);
+  // 簇的包围球按量化误差 (半个量化步长) 放大
+  Scalar error = quantizer.positionMatrix.diagonal().head<3>().norm() / 2;
+  for (auto& g : groups) {
+    for (GLCluster& c : g.second->clusters) c.radius += error;
+  }
+}
+
+void GLMesh::dequantize() {
+  if (!isQuantized()) return;
+  quantizer.decode(quantized, vertices, normals, texcoords);
+  quantized.resize(0, 8);
+}
+
+/*
+量化网格每个顶点只读取 16 字节: 位置与合并后的矩阵相乘一次完成反量化和变换,
+法线由八面体编码还原方向后乘以法线矩阵, 只在最后单位化一次
+*/
+void GLMesh::transformTo(const Matrix4& positionMtx, const Matrix3& normalMtx,
+                         Vertices& outVertices, Normals& outNormals) const {
+  if (!isQuantized()) {
+    outVertices.resize(vertices.rows(), 4);
+    outNormals.resize(normals.rows(), 3);
+    outVertices.noalias() = vertices * positionMtx;
+    outNormals.noalias() = normals * normalMtx;
+  } else {
+    Matrix4 decodeMtx = quantizer.positionMatrix * positionMtx;
+    Eigen::Index n = quantized.rows();
+    outVertices.resize(n, 4);
+    outNormals.resize(n, 3);
+    for (Eigen::Index i = 0; i < n; ++i) {
+      RowVector4 q(quantized(i, VertexQuantizer::PX), quantized(i, VertexQuantizer::PY),
+                   quantized(i, VertexQuantizer::PZ), 1);
+      outVertices.row(i).noalias() = q * decodeMtx;
+      outNormals.row(i).noalias() = quantizer.direction(quantized, i).transpose() * normalMtx;
+    }
+  }
+  for (Eigen::Index i = 0; i < outNormals.rows(); ++i) {
+    Scalar len = outNormals.row(i).norm();
+    if (len > 0) outNormals.row(i) /= len;
+  }
+}
+
 GLMesh* GLMesh::fromObjModel(ObjModel* model) {
   GLMesh* mesh = new GLMesh;
   mesh->vertices = model->vertices;
@@ -109,30 +431,64 @@ GLMesh* GLMesh::fromObjModel(ObjModel* model) {
     GLMeshGroup* meshGroup = new GLMeshGroup(mesh, name);
     meshGroup->setIndices(group.indices);
     meshGroup->setNormIndices(group.normIndices);
-    meshGroup->setTexRefs(group.texrefs);
+    meshGroup->setTexIndices(group.texIndices);
+    meshGroup->setMaterialIds(group.materialIds);
     mesh->groups[name] = meshGroup;
-    Color01 white = {1, 1, 1, 1};
-    std::vector<std::vector<Color01>> colors(meshGroup->getIndices().rows(), {white, white, white});
-    meshGroup->setColors(colors);
   }
+  // 沿用模型中的材质编号, 面的 materialIds 无需转换
+  mesh->materials = model->materials;
   if (model->mtllib) {
     for (auto mtl : model->mtllib->mtls) {
       std::string name = mtl.first;
       ObjMaterial& material = mtl.second;
-      mesh->materials[name] = mtl.second.toGLMaterial();
+      mesh->materials.set(name, std::shared_ptr<GLMaterial>(material.toGLMaterial()));
     }
   }
+  GLMeshOptimizer::optimize(*mesh);
+  mesh->computeBounds();
   return mesh;
 }
 
-GLMesh* GLMesh::readFromObjFile(std::string fpath) {
+GLMesh* GLMesh::readFromObjFile(std::string fpath, bool useCache) {
+  std::string cachePath = GLMeshCache::cachePath(fpath);
+  if (useCache) {
+    GLMesh* cached = GLMeshCache::read(cachePath);
+    if (cached) return cached;
+  }
   GLMesh* mesh = nullptr;
   ObjModel* model = ObjModel::loadObj(fpath);
   if (model) {
     mesh = fromObjModel(model);
+    if (useCache) {
+      std::vector<std::string> dependencies{fpath};
+      if (model->mtllib) dependencies.push_back(model->dirpath + "/" + model->mtllib->libname);
+      GLMeshCache::write(*mesh, cachePath, dependencies);
+    }
     delete model;
   }
   return mesh;
 }
 
+GLMesh* GLMeshBuilder::build() {
+  GLMesh* mesh = new GLMesh;
+  mesh->vertices = vertices.build();
+  mesh->normals = normals.build();
+  mesh->texcoords = texcoords.build();
+  for (auto& g : groups) {
+    std::string name = g.first;
+    GLMeshGroup* meshGroup = new GLMeshGroup(mesh, name);
+    meshGroup->indices = g.second.indices.build();
+    meshGroup->normIndices = g.second.normIndices.build();
+    meshGroup->texIndices = g.second.texIndices.build();
+    meshGroup->materialIds = std::move(g.second.materialIds);
+    meshGroup->colors = std::move(g.second.colors);
+    mesh->groups[name] = meshGroup;
+  }
+  mesh->materials = std::move(materials);
+  GLMeshOptimizer::optimize(*mesh);
+  mesh->computeBounds();
+  *this = GLMeshBuilder();
+  return mesh;
+}
+
 }  // namespace qtgl
\ No newline at end of file
@@ -7,8 +7,11 @@
 #include <iostream>
 #include <map>
 #include "affineutils.hpp"
+#include "cluster.hpp"
+#include "geombuilder.hpp"
 #include "material.hpp"
 #include "objmodel.hpp"
+#include "quantize.hpp"
 #include "scene.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
@@ -20,7 +23,7 @@ class GLScene;
 class GLObject {
  protected:
   Vertices vertices;
-  Eigen::Matrix4d modelMatrix = Eigen::Matrix4d::Identity();
+  Matrix4 modelMatrix = Matrix4::Identity();
   Vertices transfromedVertices;
 
  public:
@@ -38,10 +41,11 @@ class GLObject {
 
   Vertices& getVertices() { return vertices; }
   void setVertices(Vertices& vertices) { this->vertices = vertices; }
-  Eigen::Matrix4d& getModelMatrix() { return modelMatrix; }
-  void setModelMatrix(Eigen::Matrix4d& modelMatrix) { this->modelMatrix = modelMatrix; }
+  Matrix4& getModelMatrix() { return modelMatrix; }
+  void setModelMatrix(const Matrix4& modelMatrix) { this->modelMatrix = modelMatrix; }
   Vertices& getTransformedVertices() { return transfromedVertices; }
 
+  // 逐个追加会复制整个矩阵, 只适合少量修改; 批量构建网格使用 GLMeshBuilder
   void pushVertice(double x, double y, double z) {
     Vertice v(x, y, z, 1);
     vertices.conservativeResize(vertices.rows() + 1, vertices.cols());
@@ -57,22 +61,59 @@ class GLObject {
     this->vertices = AffineUtils::scale(this->vertices, x, y, z);
   }
   virtual void prepareTransform() = 0;
-  virtual void transformVerticesWithMatrix(Eigen::Matrix4d& mtx) = 0;
+  virtual void transformVerticesWithMatrix(Matrix4& mtx) = 0;
   virtual void transformWithModelMatrix() = 0;
   virtual void draw(QPainter& painter) = 0;
   virtual void rasterize(GLScene& scene) = 0;
+  // 世界坐标系下的包围盒, 用于确定绘制顺序; 为空时表示未知
+  virtual AlignedBox3 worldBounds() const { return AlignedBox3(); }
+
+  // 模型坐标系下的包围盒经 mtx 变换后的包围盒
+  static AlignedBox3 transformBounds(const AlignedBox3& box, const Matrix4& mtx) {
+    AlignedBox3 out;
+    if (box.isEmpty()) return out;
+    for (int c = 0; c < 8; ++c) {
+      Vector3 corner = box.corner(static_cast<AlignedBox3::CornerType>(c));
+      RowVector4 p = RowVector4(corner[0], corner[1], corner[2], 1) * mtx;
+      out.extend(Vector3(p[0], p[1], p[2]) / p[3]);
+    }
+    return out;
+  }
 };
 
 class GLMesh;
 
+// 组内使用同一材质的一段连续三角形 [begin, begin + count)
+struct MaterialBatch {
+  MaterialId material;
+  int begin;
+  int count;
+};
+
+/*
+网格的一组三角形, 逐面数据都是与 indices 行对应的平坦数组:
+  - texIndices: 纹理坐标索引, 无纹理为 -1
+  - materialIds: 材质编号, 见 GLMesh::getMaterials
+  - colors: 每个面 3 个顶点颜色, 全为默认颜色时为空
+经 GLMeshOptimizer 优化后同材质的三角形相邻, batches 记录各段, 光栅化时每段只取一次材质;
+各段再切分为簇 (clusters, 见 cluster.hpp), 供 GLMesh 在变换顶点之前整簇剔除
+*/
 class GLMeshGroup : public GLObject {
+  friend class GLMesh;
+  friend class GLMeshBuilder;
+  friend class GLMeshCache;
+  friend class GLMeshOptimizer;
+
  protected:
   GLMesh* parent;
   std::string name;
   Indices3 indices;
   NormIndices normIndices;
-  std::vector<std::vector<Color01>> colors;
-  std::vector<TexRef> texrefs;
+  Indices3 texIndices;
+  std::vector<MaterialId> materialIds;
+  std::vector<Color01> colors;
+  std::vector<MaterialBatch> batches;
+  std::vector<GLCluster> clusters;
 
  public:
   GLMeshGroup(GLMesh* parent, std::string& name) {
@@ -87,19 +128,26 @@ class GLMeshGroup : public GLObject {
   void setIndices(Indices3& indices) { this->indices = indices; }
   NormIndices& getNormIndices() { return normIndices; }
   void setNormIndices(NormIndices& normIndices) { this->normIndices = normIndices; }
-  std::vector<std::vector<Color01>>& getColors() { return colors; }
-  void setColors(std::vector<std::vector<Color01>>& colors) { this->colors = colors; }
-  std::vector<TexRef>& getTexRefs() { return texrefs; }
-  void setTexRefs(std::vector<TexRef>& texrefs) { this->texrefs = texrefs; }
+  Indices3& getTexIndices() { return texIndices; }
+  void setTexIndices(Indices3& texIndices) { this->texIndices = texIndices; }
+  std::vector<MaterialId>& getMaterialIds() { return materialIds; }
+  void setMaterialIds(std::vector<MaterialId>& materialIds) { this->materialIds = materialIds; }
+  std::vector<Color01>& getColors() { return colors; }
+  void setColors(std::vector<Color01>& colors) { this->colors = colors; }
+  const std::vector<MaterialBatch>& getBatches() const { return batches; }
+  const std::vector<GLCluster>& getClusters() const { return clusters; }
+
+  // 第 i 个面的 3 个顶点颜色
+  const Color01* faceColors(Eigen::Index i) const;
+
+  // 逐面数组补齐到面数 (无纹理, 无材质), 并按 materialIds 的连续段重建 batches
+  void buildBatches();
+  // 按 batches 切分簇, 网格焊接后才有簇 (法线与顶点一一对应)
+  void buildClusters();
 
   void addIndex3(Index3 idx);
 
-  void addIndex3(Index3 idx, Color01 clr0, Color01 clr1, Color01 clr2) {
-    indices.conservativeResize(indices.rows() + 1, indices.cols());
-    indices.row(indices.rows() - 1) = idx;
-    std::vector<Color01> tricolor{clr0, clr1, clr2};
-    colors.push_back(std::move(tricolor));
-  }
+  void addIndex3(Index3 idx, Color01 clr0, Color01 clr1, Color01 clr2);
 
   void addNormIndex(NormIndex idx) {
     normIndices.conservativeResize(normIndices.rows() + 1, normIndices.cols());
@@ -110,8 +158,11 @@ class GLMeshGroup : public GLObject {
     GLMeshGroup* g = new GLMeshGroup(this->parent, this->name);
     g->indices = indices;
     g->normIndices = normIndices;
+    g->texIndices = texIndices;
+    g->materialIds = materialIds;
     g->colors = colors;
-    g->texrefs = texrefs;
+    g->batches = batches;
+    g->clusters = clusters;
     return g;
   }
   void draw(QPainter& painter) {
@@ -122,7 +173,7 @@ class GLMeshGroup : public GLObject {
     // TODO
   }
 
-  void transformVerticesWithMatrix(Eigen::Matrix4d& mtx) {
+  void transformVerticesWithMatrix(Matrix4& mtx) {
     // TODO
   }
   void transformWithModelMatrix() {
@@ -131,8 +182,20 @@ class GLMeshGroup : public GLObject {
 
   void rasterize(GLScene& scene);
 
-  void rasterizeTriangle(GLScene& scene, Triangle2& t, std::vector<Color01>& clrs,
-                         GLMaterial* material);
+  /*
+  光栅化给定的变换结果 (屏幕坐标的顶点与单位化的世界坐标法线, 与网格顶点一一对应), 不修改本组;
+  供共享网格的多个实例使用, tint 非空时与着色结果逐分量相乘
+  */
+  void rasterize(GLScene& scene, const Vertices& screenVertices, const Normals& normals,
+                 const Color01* tint) const;
+  // 光栅化 [begin, end) 范围内使用同一材质的三角形
+  void rasterizeRange(GLScene& scene, const Vertices& screenVertices, const Normals& normals,
+                      int begin, int end, GLMaterial* material, const Color01* tint) const;
+
+  void rasterizeTriangle(GLScene& scene, Triangle2& t, const Color01* clrs, GLMaterial* material,
+                         const Color01* tint = nullptr) const;
+  // 深度预渲染: 只计算覆盖与深度, 深度更小时写入; 三角形与像素计数累加到 stats
+  static void rasterizeTriangleDepth(Fragments& fragments, Triangle2& t, GLFrameStats& stats);
 
   void drawSkeleton(QPainter& painter) {
     int n = indices.rows();
@@ -154,12 +217,59 @@ class GLMeshGroup : public GLObject {
 };
 
 class GLMesh : public GLObject {
+  friend class GLMeshBuilder;
+  friend class GLMeshCache;
+  friend class GLMeshOptimizer;
+
  protected:
   Normals normals;
   Normals transfromedNormals;
   TexCoords texcoords;
   std::map<std::string, GLMeshGroup*> groups;
-  std::map<std::string, GLMaterial*> materials;
+  GLMaterialTable materials;    // 各组的 materialIds 在此表中查找
+  AlignedBox3 bounds;           // 模型坐标系下的包围盒
+  bool welded = false;          // 各组的 indices 同时索引顶点、法线与纹理坐标, 见 GLMeshOptimizer
+  QuantizedVertices quantized;  // 量化顶点属性; 非空时 vertices、normals 与已量化的 texcoords 为空
+  VertexQuantizer quantizer;
+  bool transformPending = false;  // prepareTransform 之后, 模型与屏幕变换推迟到屏幕变换时一次完成
+  bool modelPending = false;      // 推迟的变换包含模型矩阵
+  bool clusterCulling = true;     // 按簇剔除并只变换存活的簇引用的顶点, 见 rasterizeClusters
+  bool clusterPending = false;    // prepareTransform 之后, 顶点变换推迟到光栅化时按簇进行
+  Matrix4 pendingScreenMatrix = Matrix4::Identity();
+  std::vector<uint32_t> vertexStamps;  // 顶点最近一次被变换时的 frameStamp
+  uint32_t frameStamp = 0;
+  size_t drawnClusters = 0;
+  size_t totalClusters = 0;
+  struct VisibleCluster {
+    Scalar distance;  // 模型坐标系下视点到包围球的距离, 用于由近及远排序
+    GLMeshGroup* group;
+    const GLCluster* cluster;
+  };
+
+  /*
+  剔除各组的簇, 存活的簇 (场景开启由近及远绘制时按到视点的距离排序) 按需变换其顶点
+  (每帧每个顶点至多一次) 后光栅化
+  */
+  void rasterizeClusters(GLScene& scene);
+
+  /*
+  顶点 (量化网格直接解码) 乘以 mtx 写入 transfromedVertices / transfromedNormals;
+  两个矩阵大小不变, 稳定状态下不分配内存
+  */
+  void pendingTransform(const Matrix4& mtx) {
+    Matrix4 model = modelPending ? modelMatrix : Matrix4::Identity();
+    transformTo(model * mtx, normalMatrix(model), transfromedVertices, transfromedNormals);
+    transformPending = false;
+    modelPending = false;
+  }
+
+  // 变换后的法线逐顶点单位化一次, 光栅化时直接使用
+  void normalizeTransformedNormals() {
+    for (Eigen::Index i = 0; i < transfromedNormals.rows(); ++i) {
+      double len = transfromedNormals.row(i).norm();
+      if (len > 0) transfromedNormals.row(i) /= len;
+    }
+  }
 
  public:
   const static Color01 defaultColor;
@@ -170,21 +280,25 @@ class GLMesh : public GLObject {
     for (auto g : groups) {
       delete g.second;
     }
-    for (auto m : materials) {
-      delete m.second;
-    }
   };
   GLMesh(const GLMesh& mesh) : GLObject(mesh) {
-    groups = mesh.groups;
+    for (auto g : mesh.groups) {
+      groups[g.first] = reinterpret_cast<GLMeshGroup*>((g.second)->clone());
+      groups[g.first]->setParent(this);
+    }
     normals = mesh.normals;
     transfromedNormals = mesh.transfromedNormals;
     texcoords = mesh.texcoords;
     // textures = mesh.textures;
-    materials = mesh.materials;  // TODO: deepcopy?
+    materials = mesh.materials;
+    bounds = mesh.bounds;
+    welded = mesh.welded;
+    quantized = mesh.quantized;
+    quantizer = mesh.quantizer;
+    clusterCulling = mesh.clusterCulling;
   }
   GLObject* clone() {
     GLMesh* p = new GLMesh;
-    p->groups = this->groups;
     p->vertices = this->vertices;
     p->normals = this->normals;
     for (auto g : groups) {
@@ -192,7 +306,12 @@ class GLMesh : public GLObject {
       p->groups[g.first]->setParent(p);
     }
     p->texcoords = this->texcoords;
-    p->materials = this->materials;  // TODO deepcopy?
+    p->materials = this->materials;
+    p->bounds = this->bounds;
+    p->welded = this->welded;
+    p->quantized = this->quantized;
+    p->quantizer = this->quantizer;
+    p->clusterCulling = this->clusterCulling;
     p->modelMatrix = this->modelMatrix;
     p->transfromedVertices = this->transfromedVertices;
     p->transfromedNormals = this->transfromedNormals;
@@ -207,15 +326,71 @@ class GLMesh : public GLObject {
       return groups[name];
     }
   }
+  const std::map<std::string, GLMeshGroup*>& getGroups() const { return groups; }
+  const AlignedBox3& getBounds() const { return bounds; }
+  AlignedBox3 worldBounds() const { return transformBounds(bounds, modelMatrix); }
+  bool isWelded() const { return welded; }
+
+  // mtx 对应的法线变换矩阵 (左上 3x3 的逆转置)
+  static Matrix3 normalMatrix(const Matrix4& mtx) {
+    return mtx.block<3, 3>(0, 0).inverse().transpose();
+  }
+  /*
+  顶点乘以 positionMtx、法线乘以 normalMtx 并单位化, 结果写入 outVertices / outNormals;
+  不修改网格 (量化网格直接解码), 多个实例可共用同一网格, 输出矩阵大小不变时不重新分配
+  */
+  void transformTo(const Matrix4& positionMtx, const Matrix3& normalMtx, Vertices& outVertices,
+                   Normals& outNormals) const;
+
+  /*
+  量化顶点属性 (见 quantize.hpp) 并释放 double 数组, 每个顶点由 72 字节降为 16 字节, 适合大模型;
+  要求网格已焊接 (第 i 个顶点、法线与纹理坐标属于同一顶点), 未焊接时先以 GLMeshOptimizer 焊接,
+  没有面而无法焊接时不量化. 量化后只能整体变换, 旋转 / 平移 / 缩放顶点时先自动反量化
+  */
+  void quantize();
+  void dequantize();
+  bool isQuantized() const { return quantized.rows() > 0; }
+  TexCoord texCoordAt(Eigen::Index i) const {
+    return isQuantized() && quantizer.uvQuantized ? quantizer.texcoord(quantized, i)
+                                                  : TexCoord(texcoords.row(i));
+  }
+  Vector3 positionAt(Eigen::Index i) const {
+    return isQuantized() ? Vector3(quantizer.position(quantized, i).head<3>())
+                         : Vector3(vertices.row(i).head<3>().transpose());
+  }
+  Normal normalAt(Eigen::Index i) const {
+    return isQuantized() ? quantizer.normal(quantized, i) : Normal(normals.row(i).transpose());
+  }
+  Eigen::Index vertexCount() const { return isQuantized() ? quantized.rows() : vertices.rows(); }
+
+  /*
+  簇剔除: 开启时 (默认) 整簇在视锥外或 (透视投影下) 全部背向视点的三角形不变换、不光栅化,
+  只变换存活的簇引用的顶点; 视点位于封闭模型外时结果与不剔除相同
+  */
+  void setClusterCulling(bool enabled) { clusterCulling = enabled; }
+  bool isClusterCulling() const { return clusterCulling; }
+  // 最近一次绘制中存活的簇数与总簇数
+  size_t getDrawnClusters() const { return drawnClusters; }
+  size_t getTotalClusters() const { return totalClusters; }
+  // 重新切分各组的簇, 直接修改顶点后调用
+  void buildClusters() {
+    for (auto& g : groups) g.second->buildClusters();
+  }
+
+  // 由当前顶点重新计算包围盒, 直接修改顶点后调用
+  void computeBounds() {
+    bounds.setEmpty();
+    for (Eigen::Index i = 0; i < vertices.rows(); ++i) {
+      bounds.extend(vertices.row(i).head<3>().transpose());
+    }
+  }
   Normals& getNormals() { return normals; }
   Normals& getTransformedNormals() { return transfromedNormals; }
   TexCoords& getTexCoords() { return texcoords; }
-  GLMaterial* getMaterial(std::string name) {
-    if (materials.count(name)) {
-      return materials[name];
-    } else {
-      return nullptr;
-    }
+  GLMaterialTable& getMaterials() { return materials; }
+  GLMaterial* getMaterial(MaterialId id) const { return materials.get(id); }
+  GLMaterial* getMaterial(const std::string& name) const {
+    return materials.get(materials.find(name));
   }
 
   void addIndex3(Index3 idx) { addIndex3(const_cast<std::string&>(defaultGroup), idx); }
@@ -228,12 +403,7 @@ class GLMesh : public GLObject {
   }
 
   void addIndex3(std::string& groupName, Index3 idx, Color01 clr0, Color01 clr1, Color01 clr2) {
-    GLMeshGroup* group = getGroup(groupName);
-    Indices3& indices = group->getIndices();
-    indices.conservativeResize(indices.rows() + 1, indices.cols());
-    indices.row(indices.rows() - 1) = idx;
-    std::vector<Color01> tricolor{clr0, clr1, clr2};
-    group->getColors().push_back(std::move(tricolor));
+    getGroup(groupName)->addIndex3(idx, clr0, clr1, clr2);
   }
 
   void pushNormal(double a, double b, double c) {
@@ -254,48 +424,90 @@ class GLMesh : public GLObject {
   }
 
   void rotate_x(double a) {
+    dequantize();
     this->vertices = AffineUtils::rotate_x(this->vertices, a);
     this->normals = AffineUtils::normal_rotate_x(this->normals, a);
+    computeBounds();
+    buildClusters();
   }
   void rotate_y(double a) {
+    dequantize();
     this->vertices = AffineUtils::rotate_y(this->vertices, a);
     this->normals = AffineUtils::normal_rotate_y(this->normals, a);
+    computeBounds();
+    buildClusters();
   }
   void rotate_z(double a) {
+    dequantize();
     this->vertices = AffineUtils::rotate_z(this->vertices, a);
     this->normals = AffineUtils::normal_rotate_z(this->normals, a);
+    computeBounds();
+    buildClusters();
   }
   void translate(double x, double y, double z) {
+    dequantize();
     this->vertices = AffineUtils::translate(this->vertices, x, y, z);
     this->normals = AffineUtils::normal_translate(this->normals, x, y, z);
+    computeBounds();
+    buildClusters();
   }
   void scale(double x, double y, double z) {
+    dequantize();
     this->vertices = AffineUtils::scale(this->vertices, x, y, z);
     this->normals = AffineUtils::norm_scale(this->normals, x, y, z);
+    computeBounds();
+    buildClusters();
   }
 
   void transform() {
+    if (isQuantized()) {
+      transformTo(modelMatrix, normalMatrix(modelMatrix), transfromedVertices, transfromedNormals);
+      return;
+    }
     this->transfromedVertices = AffineUtils::affine(this->vertices, this->modelMatrix);
-    Eigen::Matrix3d m = this->modelMatrix.block(0, 0, 3, 3);
+    Matrix3 m = this->modelMatrix.block(0, 0, 3, 3);
     this->transfromedNormals = AffineUtils::norm_affine(this->normals, m);
+    normalizeTransformedNormals();
   }
 
   void prepareTransform() {
-    this->transfromedVertices = this->vertices;
-    this->transfromedNormals = this->normals;
+    if (clusterCulling && welded) {
+      clusterPending = true;
+      return;
+    }
+    transformPending = true;
+    modelPending = false;
   }
 
-  void transformVerticesWithMatrix(Eigen::Matrix4d& mtx) {
+  void transformVerticesWithMatrix(Matrix4& mtx) {
+    if (clusterPending) {
+      pendingScreenMatrix = mtx;
+      return;
+    }
+    if (transformPending) {
+      pendingTransform(mtx);
+      return;
+    }
     this->transfromedVertices = AffineUtils::affine(this->transfromedVertices, mtx);
   }
   void transformWithModelMatrix() {
+    if (clusterPending) return;  // 与屏幕变换合并, 在 rasterizeClusters 中进行
+    if (transformPending) {
+      modelPending = true;
+      return;
+    }
     this->transfromedVertices = AffineUtils::affine(this->transfromedVertices, this->modelMatrix);
-    Eigen::Matrix3d m = this->modelMatrix.block(0, 0, 3, 3);
+    Matrix3 m = this->modelMatrix.block(0, 0, 3, 3);
     this->transfromedNormals = AffineUtils::norm_affine(this->transfromedNormals, m);
+    normalizeTransformedNormals();
   }
 
-  static GLMesh* readFromObjFile(std::string fpath);
+  /*
+  读取 OBJ 模型; useCache 时优先读取 OBJ 旁未过期的 .qtglmesh 缓存, 否则解析 OBJ 后写入缓存
+  */
+  static GLMesh* readFromObjFile(std::string fpath, bool useCache = true);
 
+  // 转换后经 GLMeshOptimizer 焊接并重排
   static GLMesh* fromObjModel(ObjModel* model);
 
   void rasterize(GLScene& scene);
@@ -306,4 +518,86 @@ class GLMesh : public GLObject {
   }
 };
 
+/*
+批量构建 GLMesh
+  - 顶点属性与各组的面先追加到 MatrixBuilder (均摊 O(1)), 已知数量时可预留
+  - build 时一次性拷入网格的 Eigen 矩阵, 面颜色与纹理引用直接移动
+*/
+class GLMeshBuilder {
+ private:
+  struct Group {
+    MatrixBuilder<int, 3> indices;
+    MatrixBuilder<int, 3> normIndices;
+    MatrixBuilder<int, 3> texIndices;
+    std::vector<MaterialId> materialIds;
+    std::vector<Color01> colors;  // 同 GLMeshGroup::colors, 全为默认颜色时为空
+  };
+  MatrixBuilder<Scalar, 4> vertices;
+  MatrixBuilder<Scalar, 3> normals;
+  MatrixBuilder<Scalar, 2> texcoords;
+  std::map<std::string, Group> groups;
+  GLMaterialTable materials;
+
+ public:
+  void reserve(size_t vertexCount, size_t normalCount = 0, size_t texcoordCount = 0) {
+    vertices.reserve(vertexCount);
+    normals.reserve(normalCount);
+    texcoords.reserve(texcoordCount);
+  }
+  void reserveFaces(const std::string& groupName, size_t faceCount) {
+    Group& g = groups[groupName];
+    g.indices.reserve(faceCount);
+    g.texIndices.reserve(faceCount);
+    g.materialIds.reserve(faceCount);
+  }
+
+  size_t vertexCount() const { return vertices.rows(); }
+  size_t normalCount() const { return normals.rows(); }
+  size_t texcoordCount() const { return texcoords.rows(); }
+
+  void pushVertice(double x, double y, double z) { vertices.push(x, y, z, 1); }
+  void pushNormal(double a, double b, double c) { normals.push(a, b, c); }
+  void pushTexCoord(double u, double v) { texcoords.push(u, v); }
+
+  // 追加 n 个顶点属性并返回其行, 由调用者直接写入 (顶点须写入齐次坐标);
+  // 视图在同类属性下次追加前有效
+  Eigen::Map<Vertices> appendVertices(size_t n) { return vertices.appendRows(n); }
+  Eigen::Map<Normals> appendNormals(size_t n) { return normals.appendRows(n); }
+  Eigen::Map<TexCoords> appendTexCoords(size_t n) { return texcoords.appendRows(n); }
+  // 已追加的全部顶点
+  MatrixBuilder<Scalar, 4>::RowMajorMap vertexView() const { return vertices.view(); }
+
+  void addIndex3(const std::string& groupName, Index3 idx) {
+    addIndex3(groupName, idx, GLMesh::defaultColor, GLMesh::defaultColor, GLMesh::defaultColor);
+  }
+  void addIndex3(const std::string& groupName, Index3 idx, Color01 clr0, Color01 clr1,
+                 Color01 clr2) {
+    Group& g = groups[groupName];
+    g.indices.pushRow(idx);
+    bool uniform = clr0 == GLMesh::defaultColor && clr1 == GLMesh::defaultColor &&
+                   clr2 == GLMesh::defaultColor;
+    if (g.colors.empty() && uniform) return;
+    g.colors.resize((g.indices.rows() - 1) * 3, GLMesh::defaultColor);
+    g.colors.insert(g.colors.end(), {clr0, clr1, clr2});
+  }
+  void addNormIndex(const std::string& groupName, NormIndex idx) {
+    groups[groupName].normIndices.pushRow(idx);
+  }
+  // 面的材质与纹理坐标索引 (无纹理为 -1), 按面的顺序逐个添加
+  void addTexRef(const std::string& groupName, MaterialId material, Index3 texIdx) {
+    Group& g = groups[groupName];
+    g.texIndices.pushRow(texIdx);
+    g.materialIds.push_back(material);
+  }
+
+  // 材质名对应的编号, 同一名称的面共享一个编号
+  MaterialId materialId(const std::string& name) { return materials.intern(name); }
+  void setMaterial(const std::string& name, std::shared_ptr<GLMaterial> material) {
+    materials.set(name, std::move(material));
+  }
+
+  // 生成网格 (经 GLMeshOptimizer 焊接并重排), 之后构建器被清空
+  GLMesh* build();
+};
+
 }  // namespace qtgl
\ No newline at end of file
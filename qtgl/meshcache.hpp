@@ -0,0 +1,419 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "mappedfile.hpp"
+#include "mesh.hpp"
+#include "texcache.hpp"
+
+namespace qtgl {
+
+/*
+.qtglmesh 二进制网格缓存
+  - 保存处理完成的 GLMesh: 顶点 / 法线 / 纹理坐标、各组索引与逐面的纹理索引 / 材质编号、
+    材质表及包围盒
+  - 文件由若干 64 字节对齐的段组成, 数组段与 Eigen 矩阵的内存布局一致, 读取时从映射的文件
+    按段 memcpy 到矩阵, 不做任何文本解析
+  - 文件头记录生成缓存时各源文件 (OBJ、MTL) 的大小与修改时间, 任一不符即视为过期
+
+文件布局:
+  Header | 各段数据 | Section[sectionCount] (位于 Header::tableOffset)
+变长数据 (字符串、材质) 以 u32 长度前缀的字节串表示
+*/
+class GLMeshCache {
+ private:
+  // 逐面顶点颜色按 N x 4 行主序矩阵经 matrix() 读写, 字节布局与 std::vector<Color01> 相同
+  using ColorRows = Eigen::Matrix<Scalar, Eigen::Dynamic, 4, Eigen::RowMajor>;
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t sectionCount;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t tableOffset;
+    double boundsMin[3];
+    double boundsMax[3];
+  };
+  struct Section {
+    uint32_t type;
+    uint32_t group;  // 组段所属组的序号, 其余为 0
+    uint64_t offset;
+    uint64_t bytes;
+    uint64_t rows;
+  };
+  enum SectionType : uint32_t {
+    DEPENDENCIES = 1,
+    VERTICES,
+    NORMALS,
+    TEXCOORDS,
+    MATERIALS,
+    GROUP_INFO,          // 组名
+    GROUP_INDICES,       // Indices3
+    GROUP_NORM_INDICES,  // NormIndices
+    GROUP_TEX_INDICES,   // Indices3, 纹理坐标索引
+    GROUP_MATERIAL_IDS,  // 每个面 1 个 MaterialId, 即 MATERIALS 中的序号
+    GROUP_COLORS         // 每个面 3 个 Color01; 全为默认颜色时省略
+  };
+
+  // 以小端、无对齐的方式序列化变长数据
+  class ByteWriter {
+   public:
+    std::string buf;
+    void raw(const void* p, size_t n) { buf.append(static_cast<const char*>(p), n); }
+    template <typename T>
+    void put(T v) {
+      raw(&v, sizeof(v));
+    }
+    void str(const std::string& s) {
+      put<uint32_t>(static_cast<uint32_t>(s.size()));
+      raw(s.data(), s.size());
+    }
+    void color(const Color01& c) { raw(c.data(), sizeof(Color01)); }
+  };
+
+  class ByteReader {
+   private:
+    const uint8_t* p;
+    const uint8_t* end;
+
+   public:
+    bool ok = true;
+    ByteReader(const uint8_t* data, size_t size) : p(data), end(data + size) {}
+    bool raw(void* out, size_t n) {
+      if (!ok || static_cast<size_t>(end - p) < n) return ok = false;
+      std::memcpy(out, p, n);
+      p += n;
+      return true;
+    }
+    template <typename T>
+    T get() {
+      T v{};
+      raw(&v, sizeof(v));
+      return v;
+    }
+    std::string str() {
+      uint32_t n = get<uint32_t>();
+      if (!ok || static_cast<size_t>(end - p) < n) {
+        ok = false;
+        return "";
+      }
+      std::string s(reinterpret_cast<const char*>(p), n);
+      p += n;
+      return s;
+    }
+    Color01 color() {
+      Color01 c;
+      raw(c.data(), sizeof(Color01));
+      return c;
+    }
+  };
+
+  class FileWriter {
+   public:
+    std::string buf;
+    std::vector<Section> table;
+    void section(uint32_t type, uint32_t group, const void* data, size_t bytes, uint64_t rows) {
+      buf.resize((buf.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, '\0');
+      table.push_back({type, group, buf.size(), bytes, rows});
+      buf.append(static_cast<const char*>(data), bytes);
+    }
+    template <typename M>
+    void matrix(uint32_t type, uint32_t group, const M& m) {
+      section(type, group, m.data(), sizeof(typename M::Scalar) * m.size(), m.rows());
+    }
+    template <typename T>
+    void array(uint32_t type, uint32_t group, const std::vector<T>& v) {
+      static_assert(std::is_trivially_copyable<T>::value, "array() copies raw bytes");
+      section(type, group, v.data(), sizeof(T) * v.size(), v.size());
+    }
+  };
+
+  class FileReader {
+   public:
+    std::shared_ptr<MappedFile> file;
+    std::vector<Section> table;
+    const Section* find(uint32_t type, uint32_t group = 0) const {
+      for (const Section& s : table) {
+        if (s.type == type && s.group == group) return &s;
+      }
+      return nullptr;
+    }
+    ByteReader bytes(const Section* s) const {
+      return s ? ByteReader(file->data() + s->offset, s->bytes) : ByteReader(nullptr, 0);
+    }
+    // 按段的行数重设矩阵大小并拷贝; 段缺失时置空, 大小不符时返回 false
+    template <typename M>
+    bool matrix(uint32_t type, uint32_t group, M& m) const {
+      const Section* s = find(type, group);
+      if (!s) {
+        m.resize(0, m.cols());
+        return true;
+      }
+      m.resize(static_cast<Eigen::Index>(s->rows), m.cols());
+      if (s->bytes != sizeof(typename M::Scalar) * m.size()) return false;
+      std::memcpy(m.data(), file->data() + s->offset, s->bytes);
+      return true;
+    }
+    template <typename T>
+    bool array(uint32_t type, uint32_t group, std::vector<T>& v) const {
+      static_assert(std::is_trivially_copyable<T>::value, "array() copies raw bytes");
+      const Section* s = find(type, group);
+      v.resize(s ? static_cast<size_t>(s->rows) : 0);
+      if (!s) return true;
+      if (s->bytes != sizeof(T) * v.size()) return false;
+      std::memcpy(v.data(), file->data() + s->offset, s->bytes);
+      return true;
+    }
+  };
+
+  static int64_t modifiedTime(const std::string& path, bool& ok) {
+    std::error_code ec;
+    std::filesystem::file_time_type t = std::filesystem::last_write_time(path, ec);
+    ok = !ec;
+    return ok ? static_cast<int64_t>(t.time_since_epoch().count()) : 0;
+  }
+
+  static void writeMaterial(ByteWriter& w, const GLMaterial& m) {
+    w.color(m.getAmbient());
+    w.color(m.getDiffuse());
+    w.color(m.getSpecular());
+    w.color(m.getEmmisive());
+    w.put<double>(m.getSpecularHighlight());
+    w.put<double>(m.getOpticalDensity());
+    w.put<double>(m.getDissolve());
+    w.put<int32_t>(static_cast<int32_t>(m.getIllumination()));
+    w.put<double>(m.getAmbientTextureAlpha());
+    w.put<double>(m.getDiffuseTextureAlpha());
+    w.str(m.getAmbientTexture() ? m.getAmbientTexture()->getSource() : "");
+    w.str(m.getDiffuseTexture() ? m.getDiffuseTexture()->getSource() : "");
+  }
+
+  static std::shared_ptr<GLMaterial> readMaterial(ByteReader& r) {
+    std::shared_ptr<GLMaterial> m = std::make_shared<GLMaterial>();
+    m->setAmbient(r.color());
+    m->setDiffuse(r.color());
+    m->setSpecular(r.color());
+    m->setEmmisive(r.color());
+    m->setSpecularHighlight(r.get<double>());
+    m->setOpticalDensity(r.get<double>());
+    m->setDissolve(r.get<double>());
+    m->setIllumination(static_cast<IlluminationModel>(r.get<int32_t>()));
+    m->setAmbientTextureAlpha(r.get<double>());
+    m->setDiffuseTextureAlpha(r.get<double>());
+    std::string ambient = r.str();
+    std::string diffuse = r.str();
+    if (!r.ok) return nullptr;
+    if (!ambient.empty()) m->setAmbientTexture(GLTextureCache::instance().acquire(ambient));
+    if (!diffuse.empty()) m->setDiffuseTexture(GLTextureCache::instance().acquire(diffuse));
+    return m;
+  }
+
+ public:
+  constexpr static char MAGIC[8] = {'Q', 'T', 'G', 'L', 'M', 'S', 'H', '\0'};
+  constexpr static uint32_t VERSION = 4;
+  constexpr static uint32_t FLAG_WELDED = 1;
+  // 数组段为 float (QTGL_USE_FLOAT 构建), 与当前标量类型不符时视为无效
+  constexpr static uint32_t FLAG_FLOAT = 2;
+  constexpr static uint64_t ALIGNMENT = 64;
+
+  // OBJ 文件对应的缓存文件, 与 OBJ 位于同一目录
+  static std::string cachePath(const std::string& objpath) { return objpath + ".qtglmesh"; }
+
+  /*
+  读取缓存, 文件不存在、格式不符或源文件已修改时返回 nullptr
+  */
+  static GLMesh* read(const std::string& path) {
+    FileReader f;
+    f.file = MappedFile::open(path);
+    if (!f.file || f.file->size() < sizeof(Header)) return nullptr;
+    Header h;
+    std::memcpy(&h, f.file->data(), sizeof(h));
+    bool isFloat = (h.flags & FLAG_FLOAT) != 0;
+    if (std::memcmp(h.magic, MAGIC, sizeof(h.magic)) != 0 || h.version != VERSION ||
+        isFloat != std::is_same<Scalar, float>::value || h.tableOffset > f.file->size() ||
+        (f.file->size() - h.tableOffset) / sizeof(Section) < h.sectionCount) {
+      return nullptr;
+    }
+    f.table.resize(h.sectionCount);
+    std::memcpy(f.table.data(), f.file->data() + h.tableOffset, h.sectionCount * sizeof(Section));
+    for (const Section& s : f.table) {
+      if (s.offset > f.file->size() || f.file->size() - s.offset < s.bytes) return nullptr;
+    }
+
+    // 源文件是否变化
+    ByteReader deps = f.bytes(f.find(DEPENDENCIES));
+    for (uint32_t n = deps.get<uint32_t>(), i = 0; deps.ok && i < n; ++i) {
+      std::string dep = deps.str();
+      uint64_t size = deps.get<uint64_t>();
+      int64_t mtime = deps.get<int64_t>();
+      bool ok;
+      std::error_code ec;
+      if (!deps.ok || modifiedTime(dep, ok) != mtime || !ok ||
+          std::filesystem::file_size(dep, ec) != size || ec) {
+        return nullptr;
+      }
+    }
+    if (!deps.ok) return nullptr;
+
+    std::unique_ptr<GLMesh> mesh(new GLMesh);
+    if (!f.matrix(VERTICES, 0, mesh->vertices) || !f.matrix(NORMALS, 0, mesh->normals) ||
+        !f.matrix(TEXCOORDS, 0, mesh->texcoords)) {
+      return nullptr;
+    }
+    mesh->bounds.min() = Vector3(h.boundsMin[0], h.boundsMin[1], h.boundsMin[2]);
+    mesh->bounds.max() = Vector3(h.boundsMax[0], h.boundsMax[1], h.boundsMax[2]);
+    mesh->welded = (h.flags & FLAG_WELDED) != 0;
+
+    // 按 MaterialId 的顺序, 引用了但未定义的材质只有名称
+    ByteReader mats = f.bytes(f.find(MATERIALS));
+    for (uint32_t n = mats.get<uint32_t>(), i = 0; mats.ok && i < n; ++i) {
+      MaterialId id = mesh->materials.intern(mats.str());
+      if (mats.get<uint8_t>() == 0) continue;
+      std::shared_ptr<GLMaterial> m = readMaterial(mats);
+      if (!m || id != i) return nullptr;
+      mesh->materials.set(id, m);
+    }
+    if (!mats.ok) return nullptr;
+
+    for (uint32_t g = 0;; ++g) {
+      const Section* info = f.find(GROUP_INFO, g);
+      if (!info) break;
+      ByteReader r = f.bytes(info);
+      std::string name = r.str();
+      if (!r.ok) return nullptr;
+
+      GLMeshGroup* group = new GLMeshGroup(mesh.get(), name);
+      mesh->groups[name] = group;
+      ColorRows colors(0, 4);
+      if (!f.matrix(GROUP_INDICES, g, group->indices) ||
+          !f.matrix(GROUP_NORM_INDICES, g, group->normIndices) ||
+          !f.matrix(GROUP_TEX_INDICES, g, group->texIndices) ||
+          !f.array(GROUP_MATERIAL_IDS, g, group->materialIds) ||
+          !f.matrix(GROUP_COLORS, g, colors)) {
+        return nullptr;
+      }
+      group->colors.resize(static_cast<size_t>(colors.rows()));
+      for (Eigen::Index i = 0; i < colors.rows(); ++i) group->colors[i] = colors.row(i).transpose();
+      Eigen::Index faces = group->indices.rows();
+      size_t faceCount = static_cast<size_t>(faces);
+      if (group->texIndices.rows() != faces || group->materialIds.size() != faceCount ||
+          (!group->colors.empty() && group->colors.size() != faceCount * 3)) {
+        return nullptr;
+      }
+      for (MaterialId id : group->materialIds) {
+        if (id != NO_MATERIAL && id >= mesh->materials.size()) return nullptr;
+      }
+      group->buildBatches();
+    }
+    mesh->buildClusters();
+    return mesh.release();
+  }
+
+  /*
+  写入缓存, dependencies 为生成该网格所读取的源文件; 失败时返回 false
+  先写临时文件再改名, 不会留下不完整的缓存; 已量化的网格不写入
+  */
+  static bool write(const GLMesh& mesh, const std::string& path,
+                    const std::vector<std::string>& dependencies) {
+    if (mesh.isQuantized()) return false;
+    FileWriter f;
+    f.buf.resize(sizeof(Header), '\0');
+
+    ByteWriter deps;
+    deps.put<uint32_t>(static_cast<uint32_t>(dependencies.size()));
+    for (const std::string& dep : dependencies) {
+      bool ok;
+      std::error_code ec;
+      int64_t mtime = modifiedTime(dep, ok);
+      uint64_t size = std::filesystem::file_size(dep, ec);
+      if (!ok || ec) return false;
+      deps.str(dep);
+      deps.put<uint64_t>(size);
+      deps.put<int64_t>(mtime);
+    }
+    f.section(DEPENDENCIES, 0, deps.buf.data(), deps.buf.size(), dependencies.size());
+    f.matrix(VERTICES, 0, mesh.vertices);
+    f.matrix(NORMALS, 0, mesh.normals);
+    f.matrix(TEXCOORDS, 0, mesh.texcoords);
+
+    ByteWriter mats;
+    mats.put<uint32_t>(static_cast<uint32_t>(mesh.materials.size()));
+    for (size_t i = 0; i < mesh.materials.size(); ++i) {
+      MaterialId id = static_cast<MaterialId>(i);
+      const GLMaterial* m = mesh.materials.get(id);
+      mats.str(mesh.materials.name(id));
+      mats.put<uint8_t>(m ? 1 : 0);
+      if (m) writeMaterial(mats, *m);
+    }
+    f.section(MATERIALS, 0, mats.buf.data(), mats.buf.size(), mesh.materials.size());
+
+    uint32_t g = 0;
+    for (auto& entry : mesh.groups) {
+      const GLMeshGroup& group = *entry.second;
+      ByteWriter info;
+      info.str(entry.first);
+      f.section(GROUP_INFO, g, info.buf.data(), info.buf.size(), 0);
+      f.matrix(GROUP_INDICES, g, group.indices);
+      f.matrix(GROUP_NORM_INDICES, g, group.normIndices);
+      f.matrix(GROUP_TEX_INDICES, g, group.texIndices);
+      f.array(GROUP_MATERIAL_IDS, g, group.materialIds);
+      if (!group.colors.empty()) {
+        ColorRows colors(static_cast<Eigen::Index>(group.colors.size()), 4);
+        for (size_t i = 0; i < group.colors.size(); ++i) {
+          colors.row(i) = group.colors[i].transpose();
+        }
+        f.matrix(GROUP_COLORS, g, colors);
+      }
+      ++g;
+    }
+
+    Header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, MAGIC, sizeof(h.magic));
+    h.version = VERSION;
+    h.sectionCount = static_cast<uint32_t>(f.table.size());
+    h.flags = mesh.welded ? FLAG_WELDED : 0;
+    if (std::is_same<Scalar, float>::value) h.flags |= FLAG_FLOAT;
+    f.buf.resize((f.buf.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, '\0');
+    h.tableOffset = f.buf.size();
+    AlignedBox3 bounds = mesh.bounds;
+    if (bounds.isEmpty()) bounds = AlignedBox3(Vector3::Zero(), Vector3::Zero());
+    for (int i = 0; i < 3; ++i) {
+      h.boundsMin[i] = bounds.min()[i];
+      h.boundsMax[i] = bounds.max()[i];
+    }
+    std::memcpy(&f.buf[0], &h, sizeof(h));
+    f.buf.append(reinterpret_cast<const char*>(f.table.data()), f.table.size() * sizeof(Section));
+
+    std::string tmp =
+        path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+        ".tmp";
+    std::error_code ec;
+    {
+      std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+      if (!out) return false;
+      out.write(f.buf.data(), static_cast<std::streamsize>(f.buf.size()));
+      if (!out) {
+        out.close();
+        std::filesystem::remove(tmp, ec);
+        return false;
+      }
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+      std::filesystem::remove(tmp, ec);
+      return false;
+    }
+    return true;
+  }
+};
+
+}  // namespace qtgl
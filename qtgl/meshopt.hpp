@@ -0,0 +1,385 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "mesh.hpp"
+#include "threadpool.hpp"
+
+namespace qtgl {
+
+/*
+网格加载后的优化, 依次进行
+  - 焊接: OBJ 的面对位置 / 纹理坐标 / 法线分别索引, 将 (v, vt, vn) 组合相同的角点合并为同一顶点,
+    之后各组只用一个索引缓冲, 每个顶点只变换 / 着色一次. 角点按哈希分片, 各分片由线程池并行去重
+  - 三角形重排: 每组内先按材质分段, 段内按 Forsyth 的线性时间顶点缓存优化算法调整三角形的顺序,
+    提高变换后顶点的复用
+  - 顶点重排: 按首次被引用的顺序重新编号顶点, 使光栅化时对顶点数组的访问接近顺序访问
+焊接后的法线已单位化; 缺失的法线由相邻面的面积加权法线生成, 缺失的纹理坐标为 (0, 0).
+未被任何面引用的顶点被丢弃
+*/
+class GLMeshOptimizer {
+ private:
+  struct Corner {
+    int v, t, n;  // 位置 / 纹理坐标 / 法线索引, 缺失为 -1
+    bool operator==(const Corner& o) const { return v == o.v && t == o.t && n == o.n; }
+  };
+  struct CornerHash {
+    size_t operator()(const Corner& c) const {
+      uint64_t h = static_cast<uint32_t>(c.v) * 0x9E3779B97F4A7C15ull;
+      h = (h ^ (h >> 29)) + static_cast<uint32_t>(c.t) * 0xC2B2AE3D27D4EB4Full;
+      h = (h ^ (h >> 32)) + static_cast<uint32_t>(c.n) * 0x165667B19E3779F9ull;
+      return static_cast<size_t>(h ^ (h >> 31));
+    }
+  };
+
+  // Forsyth 顶点评分: 位于缓存中越靠前、剩余未输出的三角形越少, 得分越高
+  static float vertexScore(int cachePos, int remaining) {
+    if (remaining == 0) return -1.0f;
+    float score = 0.0f;
+    if (cachePos >= 0) {
+      if (cachePos < 3) {
+        score = LAST_TRIANGLE_SCORE;  // 刚输出的三角形的顶点, 不偏向任何一个以免来回跳转
+      } else {
+        float s = 1.0f - static_cast<float>(cachePos - 3) / (CACHE_SIZE - 3);
+        score = std::pow(s, CACHE_DECAY_POWER);
+      }
+    }
+    float valence = std::pow(static_cast<float>(remaining), -VALENCE_BOOST_POWER);
+    return score + VALENCE_BOOST_SCALE * valence;
+  }
+
+  /*
+  焊接全部组的角点, 返回各组的新索引; 重新生成 mesh 的顶点 / 法线 / 纹理坐标
+  */
+  static std::vector<Indices3> weld(GLMesh& mesh, ThreadPool* pool) {
+    // 展开角点, 纹理坐标只在一个面的三个索引都有效时使用 (与光栅化时的判断一致)
+    std::vector<Corner> corners;
+    std::vector<Eigen::Index> groupBase;
+    for (auto& g : mesh.groups) {
+      GLMeshGroup& group = *g.second;
+      groupBase.push_back(static_cast<Eigen::Index>(corners.size()));
+      Eigen::Index faces = group.indices.rows();
+      bool hasNormals = group.normIndices.rows() == faces;
+      group.buildBatches();  // 补齐逐面的纹理索引与材质
+      for (Eigen::Index f = 0; f < faces; ++f) {
+        bool textured = true;
+        for (int k = 0; textured && k < 3; ++k) {
+          int t = group.texIndices(f, k);
+          textured = t >= 0 && t < mesh.texcoords.rows();
+        }
+        if (!textured) group.texIndices.row(f).setConstant(-1);
+        for (int k = 0; k < 3; ++k) {
+          int n = hasNormals ? group.normIndices(f, k) : -1;
+          if (n >= mesh.normals.rows()) n = -1;
+          corners.push_back({group.indices(f, k), textured ? group.texIndices(f, k) : -1,
+                             n < 0 ? -1 : n});
+        }
+      }
+    }
+
+    // 按哈希值分片, 各分片内按角点顺序编号
+    std::vector<std::vector<uint32_t>> shards(SHARDS);
+    std::vector<uint8_t> shardOf(corners.size());
+    for (auto& s : shards) s.reserve(corners.size() / SHARDS + 1);
+    for (size_t c = 0; c < corners.size(); ++c) {
+      uint8_t s = static_cast<uint8_t>(static_cast<uint64_t>(CornerHash()(corners[c])) % SHARDS);
+      shardOf[c] = s;
+      shards[s].push_back(static_cast<uint32_t>(c));
+    }
+    std::vector<int> localId(corners.size());
+    std::vector<std::vector<uint32_t>> firsts(SHARDS);  // 各分片中每个唯一顶点首次出现的角点
+    auto dedup = [&](size_t s) {
+      std::unordered_map<Corner, int, CornerHash> ids;
+      ids.reserve(shards[s].size());
+      for (uint32_t c : shards[s]) {
+        auto inserted = ids.emplace(corners[c], static_cast<int>(ids.size()));
+        if (inserted.second) firsts[s].push_back(c);
+        localId[c] = inserted.first->second;
+      }
+    };
+    if (pool) {
+      pool->parallelFor(SHARDS, dedup);
+    } else {
+      for (size_t s = 0; s < SHARDS; ++s) dedup(s);
+    }
+    std::vector<int> shardBase(SHARDS + 1, 0);
+    for (size_t s = 0; s < SHARDS; ++s) {
+      shardBase[s + 1] = shardBase[s] + static_cast<int>(firsts[s].size());
+    }
+
+    // 缺失法线的顶点使用相邻面法线之和 (叉积的长度即面积的两倍, 天然按面积加权)
+    bool needFaceNormals = false;
+    for (const Corner& c : corners) needFaceNormals = needFaceNormals || c.n < 0;
+    Normals faceNormals;
+    if (needFaceNormals) {
+      faceNormals = Normals::Zero(mesh.vertices.rows(), 3);
+      for (size_t c = 0; c + 2 < corners.size(); c += 3) {
+        Vector3 p0 = mesh.vertices.row(corners[c].v).head<3>().transpose();
+        Vector3 p1 = mesh.vertices.row(corners[c + 1].v).head<3>().transpose();
+        Vector3 p2 = mesh.vertices.row(corners[c + 2].v).head<3>().transpose();
+        RowVector3 fn = (p1 - p0).cross(p2 - p0).transpose();
+        for (int k = 0; k < 3; ++k) faceNormals.row(corners[c + k].v) += fn;
+      }
+    }
+
+    int count = shardBase[SHARDS];
+    Vertices vertices(count, 4);
+    Normals normals(count, 3);
+    TexCoords texcoords(count, 2);
+    for (size_t s = 0; s < SHARDS; ++s) {
+      for (size_t i = 0; i < firsts[s].size(); ++i) {
+        const Corner& c = corners[firsts[s][i]];
+        int u = shardBase[s] + static_cast<int>(i);
+        vertices.row(u) = mesh.vertices.row(c.v);
+        Normal n = c.n >= 0 ? Normal(mesh.normals.row(c.n)) : Normal(faceNormals.row(c.v));
+        double len = n.norm();
+        normals.row(u) = len > 0 ? Normal(n / len) : n;
+        texcoords.row(u) = c.t >= 0 ? TexCoord(mesh.texcoords.row(c.t)) : TexCoord(0, 0);
+      }
+    }
+    mesh.vertices = std::move(vertices);
+    mesh.normals = std::move(normals);
+    mesh.texcoords = std::move(texcoords);
+
+    std::vector<Indices3> welded;
+    size_t g = 0;
+    for (auto& entry : mesh.groups) {
+      Eigen::Index faces = entry.second->indices.rows();
+      Indices3 indices(faces, 3);
+      for (Eigen::Index f = 0; f < faces; ++f) {
+        for (int k = 0; k < 3; ++k) {
+          size_t c = static_cast<size_t>(groupBase[g] + f * 3 + k);
+          indices(f, k) = shardBase[shardOf[c]] + localId[c];
+        }
+      }
+      welded.push_back(std::move(indices));
+      ++g;
+    }
+    return welded;
+  }
+
+ public:
+  constexpr static int CACHE_SIZE = 32;
+  constexpr static float CACHE_DECAY_POWER = 1.5f;
+  constexpr static float LAST_TRIANGLE_SCORE = 0.75f;
+  constexpr static float VALENCE_BOOST_SCALE = 2.0f;
+  constexpr static float VALENCE_BOOST_POWER = 0.5f;
+  constexpr static size_t SHARDS = 64;
+
+  /*
+  Forsyth 三角形重排, 返回三角形的输出顺序
+  每步输出得分最高的三角形 (三个顶点得分之和), 只需重新评估与模拟缓存中顶点相邻的三角形;
+  缓存中的顶点没有剩余三角形时, 按原顺序取下一个未输出的三角形
+  */
+  static std::vector<int> forsythOrder(const Indices3& indices) {
+    int nt = static_cast<int>(indices.rows());
+    std::vector<int> order;
+    order.reserve(nt);
+    if (nt == 0) return order;
+
+    // 组内局部顶点编号
+    std::vector<int> verts(indices.data(), indices.data() + indices.size());
+    std::sort(verts.begin(), verts.end());
+    verts.erase(std::unique(verts.begin(), verts.end()), verts.end());
+    int nv = static_cast<int>(verts.size());
+    std::vector<int> tri(static_cast<size_t>(nt) * 3);
+    for (int t = 0; t < nt; ++t) {
+      for (int k = 0; k < 3; ++k) {
+        tri[t * 3 + k] = static_cast<int>(
+            std::lower_bound(verts.begin(), verts.end(), indices(t, k)) - verts.begin());
+      }
+    }
+    // 退化三角形中重复的顶点只计一次
+    auto repeated = [&tri](int t, int k) {
+      return (k > 0 && tri[t * 3 + k] == tri[t * 3]) || (k > 1 && tri[t * 3 + k] == tri[t * 3 + 1]);
+    };
+
+    // 顶点 -> 三角形邻接表 (CSR), 每个顶点的 [offset, offset + remaining) 为未输出的三角形
+    std::vector<int> remaining(nv, 0), offset(nv + 1, 0);
+    for (int t = 0; t < nt; ++t) {
+      for (int k = 0; k < 3; ++k) {
+        if (!repeated(t, k)) ++remaining[tri[t * 3 + k]];
+      }
+    }
+    for (int v = 0; v < nv; ++v) offset[v + 1] = offset[v] + remaining[v];
+    std::vector<int> adj(offset[nv]);
+    std::vector<int> fill(offset.begin(), offset.end() - 1);
+    for (int t = 0; t < nt; ++t) {
+      for (int k = 0; k < 3; ++k) {
+        if (!repeated(t, k)) adj[fill[tri[t * 3 + k]]++] = t;
+      }
+    }
+
+    std::vector<int> cachePos(nv, -1);
+    std::vector<float> score(nv);
+    for (int v = 0; v < nv; ++v) score[v] = vertexScore(-1, remaining[v]);
+    std::vector<char> emitted(nt, 0);
+    std::vector<int> cache, next;
+    cache.reserve(CACHE_SIZE + 3);
+    next.reserve(CACHE_SIZE + 3);
+
+    int best = -1, cursor = 0;
+    while (static_cast<int>(order.size()) < nt) {
+      if (best < 0) {
+        while (emitted[cursor]) ++cursor;
+        best = cursor;
+      }
+      order.push_back(best);
+      emitted[best] = 1;
+
+      // 从邻接表中移除, 并把三个顶点移到缓存最前
+      next.clear();
+      for (int k = 0; k < 3; ++k) {
+        if (repeated(best, k)) continue;
+        int v = tri[best * 3 + k];
+        int* list = &adj[offset[v]];
+        int* last = list + remaining[v] - 1;
+        std::iter_swap(std::find(list, last + 1, best), last);
+        --remaining[v];
+        next.push_back(v);
+      }
+      size_t head = next.size();
+      for (int v : cache) {
+        auto end = next.begin() + head;
+        if (std::find(next.begin(), end, v) == end) next.push_back(v);
+      }
+      for (size_t i = 0; i < next.size(); ++i) {
+        int v = next[i];
+        cachePos[v] = i < static_cast<size_t>(CACHE_SIZE) ? static_cast<int>(i) : -1;
+        score[v] = vertexScore(cachePos[v], remaining[v]);
+      }
+      if (next.size() > static_cast<size_t>(CACHE_SIZE)) next.resize(CACHE_SIZE);
+      std::swap(cache, next);
+
+      best = -1;
+      float bestScore = -1.0f;
+      for (int v : cache) {
+        for (int i = offset[v]; i < offset[v] + remaining[v]; ++i) {
+          int t = adj[i];
+          float s = score[tri[t * 3]] + score[tri[t * 3 + 1]] + score[tri[t * 3 + 2]];
+          if (s > bestScore) {
+            bestScore = s;
+            best = t;
+          }
+        }
+      }
+    }
+    return order;
+  }
+
+  // FIFO 顶点缓存下每个三角形平均需要变换的顶点数 (ACMR), 用于评估重排效果
+  static double acmr(const Indices3& indices, int cacheSize = CACHE_SIZE) {
+    if (indices.rows() == 0) return 0;
+    std::vector<int> fifo;
+    size_t misses = 0;
+    for (Eigen::Index i = 0; i < indices.size(); ++i) {
+      int v = indices(i / 3, i % 3);
+      if (std::find(fifo.begin(), fifo.end(), v) != fifo.end()) continue;
+      ++misses;
+      fifo.push_back(v);
+      if (static_cast<int>(fifo.size()) > cacheSize) fifo.erase(fifo.begin());
+    }
+    return static_cast<double>(misses) / indices.rows();
+  }
+
+  /*
+  焊接 + 三角形重排 + 顶点重排, 完成后 mesh.isWelded() 为真:
+  各组的 indices 同时索引顶点、法线与纹理坐标, normIndices 为空,
+  texIndices 与 indices 相同 (无纹理时为 -1);
+  同材质的三角形相邻, 各组的 batches 已按材质分段, clusters 已在各材质段内划分
+  */
+  static void optimize(GLMesh& mesh, ThreadPool* pool = &ThreadPool::shared()) {
+    size_t faces = 0;
+    for (auto& g : mesh.groups) faces += g.second->indices.rows();
+    if (mesh.welded || faces == 0) return;
+
+    std::vector<Indices3> welded = weld(mesh, pool);
+
+    // 各组独立重排三角形: 先按材质稳定排序使同材质的面相邻, 再在每段内按 Forsyth 重排;
+    // 逐面的纹理索引、材质与颜色随之移动
+    std::vector<GLMeshGroup*> groups;
+    for (auto& g : mesh.groups) groups.push_back(g.second);
+    auto reorder = [&groups, &welded](size_t g) {
+      GLMeshGroup& group = *groups[g];
+      const Indices3& indices = welded[g];
+      int faces = static_cast<int>(indices.rows());
+      std::vector<int> byMaterial(faces);
+      for (int f = 0; f < faces; ++f) byMaterial[f] = f;
+      std::stable_sort(byMaterial.begin(), byMaterial.end(), [&group](int a, int b) {
+        return group.materialIds[a] < group.materialIds[b];
+      });
+      std::vector<int> order;
+      order.reserve(faces);
+      for (int begin = 0, end; begin < faces; begin = end) {
+        MaterialId material = group.materialIds[byMaterial[begin]];
+        end = begin + 1;
+        while (end < faces && group.materialIds[byMaterial[end]] == material) ++end;
+        Indices3 run(end - begin, 3);
+        for (int i = begin; i < end; ++i) run.row(i - begin) = indices.row(byMaterial[i]);
+        std::vector<int> local = forsythOrder(run);
+        // 已有顺序更好时 (如按网格行列生成的模型) 保持不变
+        Indices3 sorted(run.rows(), 3);
+        for (size_t i = 0; i < local.size(); ++i) sorted.row(i) = run.row(local[i]);
+        bool keep = acmr(run) <= acmr(sorted);
+        for (size_t i = 0; i < local.size(); ++i) {
+          order.push_back(byMaterial[begin + (keep ? static_cast<int>(i) : local[i])]);
+        }
+      }
+
+      Indices3 sorted(faces, 3), texIndices(faces, 3);
+      std::vector<MaterialId> materialIds(faces);
+      std::vector<Color01> colors(group.colors.empty() ? 0 : group.colors.size());
+      for (int i = 0; i < faces; ++i) {
+        int f = order[i];
+        sorted.row(i) = indices.row(f);
+        texIndices.row(i) = group.texIndices.row(f);  // 索引在顶点重排后更新
+        materialIds[i] = group.materialIds[f];
+        if (!colors.empty()) std::copy_n(&group.colors[f * 3], 3, &colors[i * 3]);
+      }
+      group.indices = std::move(sorted);
+      group.normIndices.resize(0, 3);
+      group.texIndices = std::move(texIndices);
+      group.materialIds = std::move(materialIds);
+      group.colors = std::move(colors);
+      group.buildBatches();
+    };
+    if (pool) {
+      pool->parallelFor(groups.size(), reorder);
+    } else {
+      for (size_t g = 0; g < groups.size(); ++g) reorder(g);
+    }
+
+    // 按首次引用的顺序重新编号顶点
+    Eigen::Index count = mesh.vertices.rows();
+    std::vector<int> remap(count, -1);
+    int next = 0;
+    for (GLMeshGroup* group : groups) {
+      for (Eigen::Index f = 0; f < group->indices.rows(); ++f) {
+        for (int k = 0; k < 3; ++k) {
+          int& r = remap[group->indices(f, k)];
+          if (r < 0) r = next++;
+          group->indices(f, k) = r;
+        }
+        if (group->texIndices(f, 0) >= 0) group->texIndices.row(f) = group->indices.row(f);
+      }
+    }
+    Vertices vertices(count, 4);
+    Normals normals(count, 3);
+    TexCoords texcoords(count, 2);
+    for (Eigen::Index i = 0; i < count; ++i) {
+      vertices.row(remap[i]) = mesh.vertices.row(i);
+      normals.row(remap[i]) = mesh.normals.row(i);
+      texcoords.row(remap[i]) = mesh.texcoords.row(i);
+    }
+    mesh.vertices = std::move(vertices);
+    mesh.normals = std::move(normals);
+    mesh.texcoords = std::move(texcoords);
+    mesh.welded = true;
+    mesh.buildClusters();
+  }
+};
+
+}  // namespace qtgl
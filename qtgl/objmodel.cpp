@@ -1,180 +1,292 @@
 #include "objmodel.hpp"
+#include <algorithm>
+#include "geombuilder.hpp"
+#include "mappedfile.hpp"
+#include "objtokenizer.hpp"
 
 namespace qtgl {
 
+namespace {
+
+// 块内遇到 g / usemtl 之前的面沿用前一块末尾的组与材质, 拼接时才能确定
+struct FaceRun {
+  bool inheritGroup = true;
+  bool inheritMtl = true;
+  std::string group;
+  std::string mtl;
+  MatrixBuilder<int, 3> indices;
+  MatrixBuilder<int, 3> texIndices;
+  MatrixBuilder<int, 3> normIndices;
+  // 相对索引被解析为相对本块起点的位置, 拼接时需加上之前各块的元素数, 这里记录其 (按行优先的) 下标
+  std::vector<size_t> vertexFixups;
+  std::vector<size_t> texFixups;
+  std::vector<size_t> normFixups;
+};
+
+// 一个分块的解析结果, 由解析它的线程独占
+struct ObjChunk {
+  MatrixBuilder<Scalar, 4> vertices;
+  MatrixBuilder<Scalar, 3> normals;
+  MatrixBuilder<Scalar, 2> texcoords;
+  std::vector<FaceRun> runs;
+  std::string mtllib;
+};
+
+// 将 1 起始的绝对索引转换为 0 起始; 相对 (负数) 索引转换为块内位置并记入 fixups; 缺省时返回 -1
+inline int resolveIndex(int idx, size_t count, size_t slot, std::vector<size_t>& fixups) {
+  if (idx > 0) return idx - 1;
+  if (idx < 0) {
+    fixups.push_back(slot);
+    return static_cast<int>(count) + idx;
+  }
+  return -1;
+}
+
+// 拼接期间各组的面索引, 结束时一次性拷入 Eigen 矩阵
+struct FaceStaging {
+  MatrixBuilder<int, 3> indices;
+  MatrixBuilder<int, 3> normIndices;
+  MatrixBuilder<int, 3> texIndices;
+};
+
+/*
+解析 [begin, end) 范围内的完整行
+*/
+void parseChunk(const char* begin, const char* end, ObjChunk& chunk) {
+  FaceRun* run = nullptr;
+  auto newRun = [&chunk, &run]() -> FaceRun& {
+    if (!run || !run->indices.empty()) {
+      FaceRun next;
+      if (run) {
+        next.inheritGroup = run->inheritGroup;
+        next.inheritMtl = run->inheritMtl;
+        next.group = run->group;
+        next.mtl = run->mtl;
+      }
+      chunk.runs.push_back(std::move(next));
+    }
+    return *(run = &chunk.runs.back());
+  };
+
+  ObjTokenizer tok(begin, static_cast<size_t>(end - begin));
+  for (; !tok.eof(); tok.nextLine()) {
+    std::string_view key = tok.token();
+    if (key.empty() || key[0] == '#') {
+      continue;
+    } else if (key == "v") {  // vertex
+      double x = 0, y = 0, z = 0;
+      tok.number(x);
+      tok.number(y);
+      tok.number(z);
+      chunk.vertices.push(x, y, z, 1);
+    } else if (key == "vn") {  // normal
+      double a = 0, b = 0, c = 0;
+      tok.number(a);
+      tok.number(b);
+      tok.number(c);
+      chunk.normals.push(a, b, c);
+    } else if (key == "vt") {  // texture
+      double u = 0, v = 0;
+      tok.number(u);
+      tok.number(v);
+      chunk.texcoords.push(u, v);
+    } else if (key == "f") {  // face, 多边形只取前三个顶点
+      int vi[3], ti[3], ni[3];
+      int k = 0;
+      for (int v, t, n; k < 3 && tok.faceVertex(v, t, n); ++k) {
+        vi[k] = v;
+        ti[k] = t;
+        ni[k] = n;
+      }
+      if (k < 3) continue;
+      FaceRun& r = run ? *run : newRun();
+      bool hasNormal = ni[0] != 0 && ni[1] != 0 && ni[2] != 0;
+      for (k = 0; k < 3; ++k) {
+        vi[k] = resolveIndex(vi[k], chunk.vertices.rows(), r.indices.rows() * 3 + k,
+                             r.vertexFixups);
+        ti[k] = resolveIndex(ti[k], chunk.texcoords.rows(), r.texIndices.rows() * 3 + k,
+                             r.texFixups);
+        // 缺少法线的面不记录法线索引, 也不能留下指向未写入行的 fixup
+        if (hasNormal) {
+          ni[k] = resolveIndex(ni[k], chunk.normals.rows(), r.normIndices.rows() * 3 + k,
+                               r.normFixups);
+        }
+      }
+      r.indices.push(vi[0], vi[1], vi[2]);
+      r.texIndices.push(ti[0], ti[1], ti[2]);
+      if (hasNormal) r.normIndices.push(ni[0], ni[1], ni[2]);
+    } else if (key == "g") {  // group
+      std::string_view name = tok.token();
+      FaceRun& r = newRun();
+      r.inheritGroup = false;
+      r.group = name.empty() ? ObjModel::defaultGroup : ObjTokenizer::str(name);
+    } else if (key == "usemtl") {
+      FaceRun& r = newRun();
+      r.inheritMtl = false;
+      r.mtl = ObjTokenizer::str(tok.rest());
+    } else if (key == "mtllib") {
+      chunk.mtllib = ObjTokenizer::str(tok.rest());
+    }
+    // o / s: TODO
+  }
+}
+
+// 在 [p, end) 中找到下一行的起点
+const char* nextLineStart(const char* p, const char* end) {
+  while (p < end && *p != '\n') ++p;
+  return p < end ? p + 1 : end;
+}
+
+}  // namespace
+
 ObjMaterialLib* ObjMaterialLib::loadMtlLib(std::string& dirpath, std::string& libname) {
   std::string mtlpath = dirpath + "/" + libname;
-  std::ifstream ifs;
-  ifs.open(mtlpath, std::ios::in);
-  if (!ifs.is_open()) {
+  std::shared_ptr<MappedFile> file = MappedFile::open(mtlpath);
+  if (!file) {
     return nullptr;
   }
   ObjMaterialLib* mtllib = new ObjMaterialLib(dirpath, libname);
-  std::string line;
-  std::string mtlname = "";
-  int i = 0;
+  ObjMaterial* mtl = nullptr;
+  ObjMaterial unnamed;  // newmtl 之前出现的属性
+  ObjTokenizer tok(reinterpret_cast<const char*>(file->data()), file->size());
+
+  auto color = [&tok](Color01& c) {
+    double r = 0, g = 0, b = 0;
+    tok.number(r);
+    tok.number(g);
+    tok.number(b);
+    c = Color01(r, g, b, 1);
+  };
 
-  while (getline(ifs, line)) {
-    if (i++ % 10 == 0) {
-      std::cout << "loadMtlLib: " << i << std::endl;
+  for (; !tok.eof(); tok.nextLine()) {
+    std::string_view key = tok.token();
+    if (key.empty() || key[0] == '#') continue;
+    if (key == "newmtl") {
+      std::string mtlname = ObjTokenizer::str(tok.rest());
+      mtl = &(mtllib->mtls[mtlname] = ObjMaterial(dirpath, mtlname));
+      continue;
     }
-    QString qline = QString::fromStdString(line);
-    if (qline.startsWith("newmtl")) {
-      QStringList lst = qline.split(QRegExp("\\s+"));
-      mtlname = lst[1].toStdString();
-      mtllib->mtls[mtlname] = ObjMaterial(dirpath, mtlname);
-    } else if (qline.startsWith("Ns")) {
-      QStringList lst = qline.split(QRegExp("\\s+"));
-      mtllib->mtls[mtlname].ns = lst[1].toDouble();
-    } else if (qline.startsWith("Ka")) {
-      QStringList lst = qline.split(QRegExp("\\s+"));
-      mtllib->mtls[mtlname].ka = {lst[1].toDouble(), lst[2].toDouble(), lst[3].toDouble(), 1};
-    } else if (qline.startsWith("Kd")) {
-      QStringList lst = qline.split(QRegExp("\\s+"));
-      mtllib->mtls[mtlname].kd = {lst[1].toDouble(), lst[2].toDouble(), lst[3].toDouble(), 1};
-    } else if (qline.startsWith("Ks")) {
-      QStringList lst = qline.split(QRegExp("\\s+"));
-      mtllib->mtls[mtlname].ks = {lst[1].toDouble(), lst[2].toDouble(), lst[3].toDouble(), 1};
-    } else if (qline.startsWith("Ke")) {
-      QStringList lst = qline.split(QRegExp("\\s+"));
-      mtllib->mtls[mtlname].ke = {lst[1].toDouble(), lst[2].toDouble(), lst[3].toDouble(), 1};
-    } else if (qline.startsWith("Ns")) {
-      QStringList lst = qline.split(QRegExp("\\s+"));
-      mtllib->mtls[mtlname].ns = lst[1].toDouble();
-    } else if (qline.startsWith("Ni")) {
-      QStringList lst = qline.split(QRegExp("\\s+"));
-      mtllib->mtls[mtlname].ni = lst[1].toDouble();
-    } else if (qline.startsWith("d")) {
-      QStringList lst = qline.split(QRegExp("\\s+"));
-      mtllib->mtls[mtlname].d = lst[1].toDouble();
-    } else if (qline.startsWith("illum")) {
-      QStringList lst = qline.split(QRegExp("\\s+"));
-      mtllib->mtls[mtlname].illum = lst[1].toInt();
-    } else if (qline.startsWith("map_refl")) {
-      QStringList lst = qline.split(QRegExp("\\s+"));
-      mtllib->mtls[mtlname].map_refl = lst[1].toStdString();
-    } else if (qline.startsWith("map_Ka")) {
-      QStringList lst = qline.split(QRegExp("\\s+"));
-      mtllib->mtls[mtlname].map_ka = lst[1].toStdString();
-    } else if (qline.startsWith("map_Kd")) {
-      QStringList lst = qline.split(QRegExp("\\s+"));
-      mtllib->mtls[mtlname].map_kd = lst[1].toStdString();
+    ObjMaterial& m = mtl ? *mtl : unnamed;
+    if (key == "Ns") {
+      tok.number(m.ns);
+    } else if (key == "Ka") {
+      color(m.ka);
+    } else if (key == "Kd") {
+      color(m.kd);
+    } else if (key == "Ks") {
+      color(m.ks);
+    } else if (key == "Ke") {
+      color(m.ke);
+    } else if (key == "Ni") {
+      tok.number(m.ni);
+    } else if (key == "d") {
+      tok.number(m.d);
+    } else if (key == "illum") {
+      double illum = 0;
+      tok.number(illum);
+      m.illum = static_cast<int>(illum);
+    } else if (key == "map_refl") {
+      m.map_refl = ObjTokenizer::str(tok.rest());
+    } else if (key == "map_Ka") {
+      m.map_ka = ObjTokenizer::str(tok.rest());
+    } else if (key == "map_Kd") {
+      m.map_kd = ObjTokenizer::str(tok.rest());
     }
   }
-  ifs.close();
   return mtllib;
 }
 
 const std::string ObjModel::defaultGroup = "default";
 
-ObjModel* ObjModel::loadObj(const std::string& objpath) {
-  std::string group = ObjModel::defaultGroup;
-  std::string mtl = "";
-  std::ifstream ifs;
-  ifs.open(objpath, std::ios::in);
-
-  if (!ifs.is_open()) {
+/*
+在内存映射的文件内容上逐行解析, 除新建组、材质名及暂存区扩容外不分配内存
+  - 文件按行边界切分为若干块, 由线程池与调用线程并行解析到各自的缓冲区
+  - 拼接时按块的顺序做前缀和: 确定各块顶点属性在最终数组中的起始位置,
+    修正相对索引, 并把上一块末尾的组 / 材质状态传给下一块开头的面
+  - 调用线程也参与解析 (见 ThreadPool::parallelFor), 在线程池任务中调用不会死锁
+*/
+ObjModel* ObjModel::loadObj(const std::string& objpath, ThreadPool* pool) {
+  std::shared_ptr<MappedFile> file = MappedFile::open(objpath);
+  if (!file) {
     return nullptr;
   }
   ObjModel* model = new ObjModel;
   model->objpath = objpath;
   model->dirpath = objpath.substr(0, objpath.find_last_of("/\\"));
   model->objname = objpath.substr(objpath.find_last_of("/\\") + 1);
-  std::string line;
-  int i = 0;
 
-  std::list<double> verticeLst;
-  std::list<double> normalLst;
-  std::list<double> texcoordLst;
+  // 切分
+  const char* begin = reinterpret_cast<const char*>(file->data());
+  const char* end = begin + file->size();
+  size_t workers = pool ? static_cast<size_t>(pool->size()) + 1 : 1;
+  size_t chunkCount = std::max<size_t>(1, std::min(workers * 4, file->size() / MIN_CHUNK_BYTES));
+  std::vector<const char*> bounds{begin};
+  for (size_t i = 1; i < chunkCount; ++i) {
+    const char* b = nextLineStart(begin + file->size() * i / chunkCount - 1, end);
+    if (b > bounds.back() && b < end) bounds.push_back(b);
+  }
+  bounds.push_back(end);
+  chunkCount = bounds.size() - 1;
 
-  while (getline(ifs, line)) {
-    if (i++ % 1000 == 0) {
-      std::cout << "loadObj: " << i << std::endl;
-    }
-    QString qline = QString::fromStdString(line);
-    if (qline.startsWith("v ")) {  // vertex
-      QStringList strlst = qline.split(QRegExp("\\s+"));
-
-      // model->pushVertice(strlst[1].toDouble(), strlst[2].toDouble(), strlst[3].toDouble());
-      verticeLst.push_back(strlst[1].toDouble());
-      verticeLst.push_back(strlst[2].toDouble());
-      verticeLst.push_back(strlst[3].toDouble());
-
-    } else if (qline.startsWith("f ")) {  // face
-
-      QStringList strlst = qline.split(QRegExp("\\s+"));
-      std::vector<int> vi;
-      std::vector<int> ni;
-      std::vector<int> ti;
-      for (int i = 1; i < strlst.length(); ++i) {
-        QStringList lst = strlst[i].split("/");
-        vi.push_back(lst[0].toInt() - 1);
-        if (lst.length() >= 2 && !lst[1].isEmpty()) {
-          ti.push_back(lst[1].toInt() - 1);
-        } else {
-          ti.push_back(-1);
-        }
-        if (lst.length() >= 2 && !lst[2].isEmpty()) {
-          ni.push_back(lst[2].toInt() - 1);
-        }
-      }
-      Index3 idx{vi[0], vi[1], vi[2]};
-      model->addIndex3(group, idx);  // TODO optimize
+  // 解析
+  std::vector<ObjChunk> chunks(chunkCount);
+  auto parse = [&chunks, &bounds](size_t i) { parseChunk(bounds[i], bounds[i + 1], chunks[i]); };
+  if (pool) {
+    pool->parallelFor(chunkCount, parse);
+  } else {
+    for (size_t i = 0; i < chunkCount; ++i) parse(i);
+  }
 
-      if (!ti.empty()) {
-        Eigen::Vector3i texidx{ti[0], ti[1], ti[2]};
-        model->addTexRef(group, mtl, texidx);
-      }
+  // 拼接
+  size_t vertexCount = 0, normalCount = 0, texcoordCount = 0;
+  for (ObjChunk& c : chunks) {
+    vertexCount += c.vertices.rows();
+    normalCount += c.normals.rows();
+    texcoordCount += c.texcoords.rows();
+  }
+  model->vertices.resize(vertexCount, 4);
+  model->normals.resize(normalCount, 3);
+  model->texcoords.resize(texcoordCount, 2);
 
-      if (!ni.empty()) {
-        NormIndex normidx{ni[0], ni[1], ni[2]};
-        model->addNormIndex(group, normidx);  // TODO optimize
-      }
-    } else if (qline.startsWith("g ")) {  // group
-      QStringList lst = qline.trimmed().split(QRegExp("\\s+"));
-      if (lst.length() < 2) {
-        group = defaultGroup;
-      } else {
-        group = lst[1].toStdString();
-      }
+  std::map<ObjModelGroup*, FaceStaging> staging;
+  std::string groupName = ObjModel::defaultGroup;
+  std::string mtl = "";
+  std::string mtllib = "";
+  size_t vertexBase = 0, normalBase = 0, texcoordBase = 0;
+  for (ObjChunk& c : chunks) {
+    c.vertices.copyTo(model->vertices, vertexBase);
+    c.normals.copyTo(model->normals, normalBase);
+    c.texcoords.copyTo(model->texcoords, texcoordBase);
+    for (FaceRun& run : c.runs) {
+      if (!run.inheritGroup) groupName = run.group;
+      if (!run.inheritMtl) mtl = run.mtl;
+      if (run.indices.empty()) continue;
+      for (size_t i : run.vertexFixups) run.indices[i] += static_cast<int>(vertexBase);
+      for (size_t i : run.texFixups) run.texIndices[i] += static_cast<int>(texcoordBase);
+      for (size_t i : run.normFixups) run.normIndices[i] += static_cast<int>(normalBase);
 
-      std::cout << group << std::endl;
-
-    } else if (qline.startsWith("vn")) {  // normal
-      QStringList strlst = qline.split(QRegExp("\\s+"));
-
-      // model->pushNormal(strlst[1].toDouble(), strlst[2].toDouble(), strlst[3].toDouble());
-      normalLst.push_back(strlst[1].toDouble());
-      normalLst.push_back(strlst[2].toDouble());
-      normalLst.push_back(strlst[3].toDouble());
-
-    } else if (qline.startsWith("vt")) {  // texture
-      QStringList strlst = qline.split(QRegExp("\\s+"));
-
-      // model->pushTexCoord(strlst[1].toDouble(), strlst[2].toDouble());
-      texcoordLst.push_back(strlst[1].toDouble());
-      texcoordLst.push_back(strlst[2].toDouble());
-
-    } else if (qline.startsWith("#")) {
-      continue;  // do nothing
-    } else if (qline.startsWith("mtllib")) {
-      model->mtllib =
-          ObjMaterialLib::loadMtlLib(model->dirpath, qline.split(QRegExp("\\s+"))[1].toStdString());
-    } else if (qline.startsWith("o ")) {
-      // TODO
-    } else if (qline.startsWith("s ")) {
-      // TODO
-    } else if (qline.startsWith("usemtl")) {
-      QStringList lst = qline.trimmed().split(QRegExp("\\s+"));
-      mtl = lst[1].toStdString();
+      ObjModelGroup& group = model->getGroup(groupName);
+      FaceStaging& faces = staging[&group];
+      faces.indices.append(run.indices);
+      faces.normIndices.append(run.normIndices);
+      faces.texIndices.append(run.texIndices);
+      // 材质名只在每段连续的面上驻留一次
+      MaterialId mtlId = mtl.empty() ? NO_MATERIAL : model->materials.intern(mtl);
+      group.materialIds.insert(group.materialIds.end(), run.texIndices.rows(), mtlId);
     }
+    if (!c.mtllib.empty()) mtllib = c.mtllib;
+    vertexBase += c.vertices.rows();
+    normalBase += c.normals.rows();
+    texcoordBase += c.texcoords.rows();
+  }
+  for (auto& s : staging) {
+    s.first->indices = s.second.indices.build();
+    s.first->normIndices = s.second.normIndices.build();
+    s.first->texIndices = s.second.texIndices.build();
+  }
+  if (!mtllib.empty()) {
+    model->mtllib = ObjMaterialLib::loadMtlLib(model->dirpath, mtllib);
   }
-
-  model->setVertices(verticeLst);
-  model->setNormals(normalLst);
-  model->setTexcoords(texcoordLst);
-
-  ifs.close();
   return model;
 }
-}  // namespace qtgl
\ No newline at end of file
+}  // namespace qtgl
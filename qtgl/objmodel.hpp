@@ -1,15 +1,13 @@
 #pragma once
 
-#include <QString>
-#include <QStringList>
-#include <fstream>
-#include <iostream>
-#include <list>
 #include <map>
 #include <string>
+#include <vector>
 #include "define.hpp"
 #include "material.hpp"
+#include "texcache.hpp"
 #include "texture.hpp"
+#include "threadpool.hpp"
 
 namespace qtgl {
 
@@ -17,14 +15,15 @@ class ObjMaterial {
  public:
   std::string dirpath;
   std::string name;
-  double ns;
-  Color01 ka;
-  Color01 kd;
-  Color01 ks;
-  Color01 ke;
-  double ni;
-  double d;
-  int illum;
+  // MTL 中缺省的属性取以下默认值
+  double ns = 0;
+  Color01 ka = {0, 0, 0, 1};
+  Color01 kd = {0, 0, 0, 1};
+  Color01 ks = {0, 0, 0, 1};
+  Color01 ke = {0, 0, 0, 1};
+  double ni = 1;
+  double d = 1;
+  int illum = 2;
   std::string map_ka = "";
   std::string map_kd = "";
   std::string map_refl = "";
@@ -54,14 +53,12 @@ class ObjMaterial {
       material->setIllumination(IlluminationModel::LAMBERTIAN_BLINN_PHONG);
     }
     if (!map_ka.empty()) {
-      GLTexture* t = new InterpolateGLTexture(dirpath + "/" + map_ka);
-      material->setAmbientTexture(t);
+      material->setAmbientTexture(GLTextureCache::instance().acquire(dirpath + "/" + map_ka));
     } else {
       material->setAmbientTexture(nullptr);
     }
     if (!map_kd.empty()) {
-      GLTexture* t = new InterpolateGLTexture(dirpath + "/" + map_kd);
-      material->setDiffuseTexture(t);
+      material->setDiffuseTexture(GLTextureCache::instance().acquire(dirpath + "/" + map_kd));
     } else {
       material->setDiffuseTexture(nullptr);
     }
@@ -82,17 +79,6 @@ class ObjMaterialLib {
   static ObjMaterialLib* loadMtlLib(std::string& dirpath, std::string& libname);
 };
 
-class TexRef {
- public:
-  std::string mtlname = "";
-  Eigen::Vector3i indices;
-  TexRef() = default;
-  TexRef(std::string& mtlname, Eigen::Vector3i& indices) {
-    this->mtlname = mtlname;
-    this->indices = indices;
-  }
-};
-
 class ObjModel;
 
 class ObjModelGroup {
@@ -102,7 +88,8 @@ class ObjModelGroup {
   Indices3 indices;
   NormIndices normIndices;
   std::string mtlname;
-  std::vector<TexRef> texrefs;
+  Indices3 texIndices;                  // 每个面的纹理坐标索引, 缺省为 -1
+  std::vector<MaterialId> materialIds;  // 每个面的材质, 见 ObjModel::materials
 
   ObjModelGroup() = default;
 
@@ -110,18 +97,6 @@ class ObjModelGroup {
     this->parent = parent;
     this->name = name;
   }
-
-  void addIndex3(Index3 idx) {
-    indices.conservativeResize(indices.rows() + 1, indices.cols());
-    indices.row(indices.rows() - 1) = idx;
-  }
-
-  void addNormIndex(NormIndex idx) {
-    normIndices.conservativeResize(normIndices.rows() + 1, normIndices.cols());
-    normIndices.row(normIndices.rows() - 1) = idx;
-  }
-
-  void addTexRef(TexRef& texref) { texrefs.push_back(texref); }
 };
 
 class ObjModel {
@@ -130,8 +105,9 @@ class ObjModel {
   std::string objpath;
   std::string dirpath;
   std::string objname;
-  ObjMaterialLib* mtllib;
+  ObjMaterialLib* mtllib = nullptr;
   std::map<std::string, ObjModelGroup> groups;
+  GLMaterialTable materials;  // usemtl 引用的材质名, 材质本身在转换为 GLMesh 时由 mtllib 填入
   Vertices vertices;
   Normals normals;
   TexCoords texcoords;
@@ -139,64 +115,6 @@ class ObjModel {
   ObjModel() = default;
   ~ObjModel() { delete mtllib; };
 
-  void pushVertice(double x, double y, double z) {
-    Vertice v(x, y, z, 1);
-    vertices.conservativeResize(vertices.rows() + 1, vertices.cols());
-    vertices.row(vertices.rows() - 1) = v;
-  }
-
-  void pushNormal(double a, double b, double c) {
-    Normal n(a, b, c);
-    normals.conservativeResize(normals.rows() + 1, normals.cols());
-    normals.row(normals.rows() - 1) = n;
-  }
-
-  void pushTexCoord(double u, double v) {
-    TexCoord t(u, v);
-    texcoords.conservativeResize(texcoords.rows() + 1, texcoords.cols());
-    texcoords.row(texcoords.rows() - 1) = t;
-  }
-
-  void setVertices(std::list<double>& vs) {
-    size_t rows = vs.size() / 3;
-    vertices.conservativeResize(rows, 4);
-    int r = 0;
-    auto p = vs.begin();
-    Vertice v;
-    while (p != vs.end()) {
-      v[0] = *p++;
-      v[1] = *p++;
-      v[2] = *p++;
-      v[3] = 1;
-      vertices.row(r++) = v;
-    }
-  }
-  void setNormals(std::list<double>& ns) {
-    size_t rows = ns.size() / 3;
-    normals.conservativeResize(rows, 3);
-    int r = 0;
-    auto p = ns.begin();
-    Normal n;
-    while (p != ns.end()) {
-      n[0] = *p++;
-      n[1] = *p++;
-      n[2] = *p++;
-      normals.row(r++) = n;
-    }
-  }
-  void setTexcoords(std::list<double>& ts) {
-    size_t rows = ts.size() / 2;
-    texcoords.conservativeResize(rows, 2);
-    int r = 0;
-    auto p = ts.begin();
-    TexCoord t;
-    while (p != ts.end()) {
-      t[0] = *p++;
-      t[1] = *p++;
-      texcoords.row(r++) = t;
-    }
-  }
-
   ObjModelGroup& getGroup(std::string& name) {
     if (groups.count(name)) {
       return groups[name];
@@ -206,20 +124,14 @@ class ObjModel {
     }
   }
 
-  void addIndex3(std::string& groupName, Index3 idx) { getGroup(groupName).addIndex3(idx); }
-
-  void addNormIndex(std::string& groupName, NormIndex idx) {
-    getGroup(groupName).addNormIndex(idx);
-  }
-
-  void addTexRef(std::string& groupName, std::string& mtlname, Eigen::Vector3i& indices) {
-    TexRef texref;
-    texref.mtlname = mtlname;
-    texref.indices = indices;
-    getGroup(groupName).texrefs.push_back(texref);
-  }
+  // 小于该大小的文件不再切分
+  constexpr static size_t MIN_CHUNK_BYTES = 1 << 20;
 
-  static ObjModel* loadObj(const std::string& objpath);
+  /*
+  读取 OBJ 文件及其材质库, 失败时返回 nullptr
+  pool 非空且文件较大时分块并行解析; 为空时在调用线程中解析
+  */
+  static ObjModel* loadObj(const std::string& objpath, ThreadPool* pool = &ThreadPool::shared());
 };
 
 }  // namespace qtgl
\ No newline at end of file
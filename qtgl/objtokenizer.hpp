@@ -0,0 +1,112 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace qtgl {
+
+/*
+OBJ / MTL 文本的逐字节词法分析器
+  - 直接在 (内存映射的) 文件内容上移动游标, 关键字和名称以 string_view 返回, 不拷贝、不分配内存
+  - 数值使用 std::from_chars 解析, 与 locale 无关
+  - 一行内的读取方法都不会越过行尾, 调用 nextLine 进入下一行
+*/
+class ObjTokenizer {
+ private:
+  const char* p;
+  const char* end;
+
+  static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v'; }
+  static bool isDelimiter(char c) { return isSpace(c) || c == '\n'; }
+
+ public:
+  ObjTokenizer(const char* data, size_t size) : p(data), end(data + size) {}
+
+  bool eof() const { return p >= end; }
+  const char* position() const { return p; }
+
+  void skipSpaces() {
+    while (p < end && isSpace(*p)) ++p;
+  }
+
+  bool atLineEnd() {
+    skipSpaces();
+    return p >= end || *p == '\n';
+  }
+
+  // 跳过本行剩余内容 (包括换行符)
+  void nextLine() {
+    while (p < end && *p != '\n') ++p;
+    if (p < end) ++p;
+  }
+
+  // 下一个以空白分隔的词, 行尾时返回空
+  std::string_view token() {
+    skipSpaces();
+    const char* b = p;
+    while (p < end && !isDelimiter(*p)) ++p;
+    return std::string_view(b, static_cast<size_t>(p - b));
+  }
+
+  // 本行剩余内容, 去掉首尾空白; 用于可能包含空格的名称和路径
+  std::string_view rest() {
+    skipSpaces();
+    const char* b = p;
+    while (p < end && *p != '\n') ++p;
+    const char* e = p;
+    while (e > b && isSpace(e[-1])) --e;
+    return std::string_view(b, static_cast<size_t>(e - b));
+  }
+
+  // 读取一个实数, 失败时跳过该词并返回 false
+  bool number(double& value) {
+    skipSpaces();
+    if (p < end && *p == '+') ++p;
+    std::from_chars_result r = std::from_chars(p, end, value);
+    if (r.ec != std::errc() || (r.ptr < end && !isDelimiter(*r.ptr))) {
+      token();
+      return false;
+    }
+    p = r.ptr;
+    return true;
+  }
+
+  // 读取一个整数, 不跳过前导空白; 失败时返回 false 且不移动游标
+  bool integer(int& value) {
+    const char* q = p;
+    if (q < end && *q == '+') ++q;  // from_chars 不接受前导 '+'
+    std::from_chars_result r = std::from_chars(q, end, value);
+    if (r.ec != std::errc()) return false;
+    p = r.ptr;
+    return true;
+  }
+
+  /*
+  读取面的一个顶点引用: v, v/t, v//n 或 v/t/n
+  缺省的分量置 0 (OBJ 索引从 1 开始, 负数为相对索引); 行尾或格式错误时返回 false
+  */
+  bool faceVertex(int& v, int& t, int& n) {
+    skipSpaces();
+    v = t = n = 0;
+    if (!integer(v)) {
+      token();
+      return false;
+    }
+    if (p < end && *p == '/') {
+      ++p;
+      integer(t);
+      if (p < end && *p == '/') {
+        ++p;
+        integer(n);
+      }
+    }
+    return true;
+  }
+
+  static std::string str(std::string_view s) { return std::string(s.data(), s.size()); }
+};
+
+}  // namespace qtgl
@@ -11,54 +11,54 @@ enum class GLProjectionMode {
 
 class GLProjection {
  public:
-  double height, width;
-  double near, far;
+  Scalar height, width;
+  Scalar near, far;
   GLProjectionMode mode;
   GLProjection()
       : height(768), width(1024), near(0.1f), far(100), mode(GLProjectionMode::PRESPECTIVE) {}
-  GLProjection(double height, double width, double near, double far, GLProjectionMode mode)
+  GLProjection(Scalar height, Scalar width, Scalar near, Scalar far, GLProjectionMode mode)
       : height(height), width(width), near(near), far(far), mode(mode) {}
-  Eigen::Matrix4d orthographicProjMatrix() {
-    double hfov = MathUtils::PI / 3;
-    double vfov = hfov * (height / width);
-    double right = tan(hfov / 2) * near;
-    double left = -right;
-    double top = tan(vfov / 2) * near;
-    double bottom = -top;
+  Matrix4 orthographicProjMatrix() {
+    Scalar hfov = MathUtils::PI / 3;
+    Scalar vfov = hfov * (height / width);
+    Scalar right = tan(hfov / 2) * near;
+    Scalar left = -right;
+    Scalar top = tan(vfov / 2) * near;
+    Scalar bottom = -top;
 
-    double m00 = 2 / (right - left);
-    double m11 = 2 / (top - bottom);
-    double m22 = 2 / (near - far);
-    double m30 = -(right + left) / (right - left);
-    double m31 = -(top + bottom) / (top - bottom);
-    double m32 = -(near + far) / (near - far);
+    Scalar m00 = 2 / (right - left);
+    Scalar m11 = 2 / (top - bottom);
+    Scalar m22 = 2 / (near - far);
+    Scalar m30 = -(right + left) / (right - left);
+    Scalar m31 = -(top + bottom) / (top - bottom);
+    Scalar m32 = -(near + far) / (near - far);
 
-    Eigen::Matrix4d projMtx;
+    Matrix4 projMtx;
     projMtx << m00, 0, 0, 0,  //
         0, m11, 0, 0,         //
         0, 0, m22, 0,         //
         m30, m31, m32, 1;
     return projMtx;
   }
-  Eigen::Matrix4d perspectiveProjMatrix() {
-    double hfov = MathUtils::PI / 3;
-    double vfov = hfov * (height / width);
-    double right = tan(hfov / 2) * near;
-    double left = -right;
-    double top = tan(vfov / 2) * near;
-    double bottom = -top;
-    double m00 = 2 / (right - left);
-    double m11 = 2 / (top - bottom);
-    double m22 = (far + near) / (far - near);
-    double m32 = -2 * near * far / (far - near);
-    Eigen::Matrix4d projMtx;
+  Matrix4 perspectiveProjMatrix() {
+    Scalar hfov = MathUtils::PI / 3;
+    Scalar vfov = hfov * (height / width);
+    Scalar right = tan(hfov / 2) * near;
+    Scalar left = -right;
+    Scalar top = tan(vfov / 2) * near;
+    Scalar bottom = -top;
+    Scalar m00 = 2 / (right - left);
+    Scalar m11 = 2 / (top - bottom);
+    Scalar m22 = (far + near) / (far - near);
+    Scalar m32 = -2 * near * far / (far - near);
+    Matrix4 projMtx;
     projMtx << m00, 0, 0, 0,  //
         0, m11, 0, 0,         //
         0, 0, m22, 1,         //
         0, 0, m32, 0;
     return projMtx;
   }
-  Eigen::Matrix4d projMatrix() {
+  Matrix4 projMatrix() {
     if (mode == GLProjectionMode::ORTHOGRAPHIC) {
       return orthographicProjMatrix();
     } else {
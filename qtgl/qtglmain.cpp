@@ -11,6 +11,7 @@ int main(int argc, char* argv[]) {
 
   qtgl::GLRenderWidget widget;
   widget.setFixedSize(1000, 1000);
+  widget.setStatsOverlay(true);
 
   // mesh axis
   std::string axisobjpath = "E:\\codes\\practice\\qt-learning\\data\\xyz_axis\\xyz_axis.obj";
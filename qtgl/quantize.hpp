@@ -0,0 +1,141 @@
+#pragma once
+
+#include "alloccount.hpp"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "define.hpp"
+
+namespace qtgl {
+
+/*
+量化的顶点属性, 每行一个顶点 (16 字节):
+  - 位置: 按网格包围盒量化的 3 个 16 位无符号整数
+  - 法线: 八面体映射后的 2 个 16 位有符号整数 (按位存放)
+  - 纹理坐标: 按网格纹理坐标范围量化的 2 个 16 位 UNORM
+  - 1 个 16 位填充
+未量化时位置 / 法线 / 纹理坐标共 72 字节
+*/
+using QuantizedVertices = Eigen::Matrix<uint16_t, Eigen::Dynamic, 8, Eigen::RowMajor>;
+
+/*
+顶点属性的量化参数与编解码
+  - 位置反量化 (缩放 + 平移) 表示为仿射矩阵 positionMatrix, 可与模型矩阵合并, 变换时一次完成
+  - 位置误差不超过包围盒各轴边长的 1/131070; 法线角度误差约 1e-4 弧度
+  - 纹理坐标通常位于 [0, 1], 超出时 (重复寻址) 按实际范围量化, 精度相应降低;
+    范围超过 MAX_UV_RANGE 时误差已不可接受, 纹理坐标不量化 (uvQuantized 为 false), 由网格保留原数组
+*/
+class VertexQuantizer {
+ public:
+  enum Column { PX = 0, PY, PZ, NX, NY, U, V };
+  constexpr static double MAX_UV_RANGE = 8;
+
+  Matrix4 positionMatrix = Matrix4::Identity();  // [qx qy qz 1] * M = 模型坐标
+  Vector2 uvMin = Vector2::Zero();
+  Vector2 uvScale = Vector2::Ones();
+  bool uvQuantized = true;
+
+  static uint16_t unorm16(double x) {
+    return static_cast<uint16_t>(std::lround(std::min(std::max(x, 0.0), 1.0) * 65535.0));
+  }
+  static uint16_t snorm16(double x) {
+    long v = std::lround(std::min(std::max(x, -1.0), 1.0) * 32767.0);
+    return static_cast<uint16_t>(static_cast<int16_t>(v));
+  }
+  static double fromSnorm16(uint16_t bits) { return static_cast<int16_t>(bits) / 32767.0; }
+
+  // 单位法线 -> 八面体平面上 [-1, 1]^2 的点; 下半球沿对角线折叠到外侧的三角形
+  static Vector2 octEncode(const Normal& n) {
+    double l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+    if (l1 == 0) return Vector2(0, 0);
+    Vector2 p(n[0] / l1, n[1] / l1);
+    if (n[2] < 0) {
+      p = Vector2((1 - std::fabs(p[1])) * (p[0] >= 0 ? 1 : -1),
+                  (1 - std::fabs(p[0])) * (p[1] >= 0 ? 1 : -1));
+    }
+    return p;
+  }
+  // 未单位化的方向; 之后还要做线性变换时可在变换后再单位化
+  static Normal octDirection(double x, double y) {
+    Normal n(x, y, 1 - std::fabs(x) - std::fabs(y));
+    Scalar t = std::max<Scalar>(-n[2], 0);
+    n[0] += n[0] >= 0 ? -t : t;
+    n[1] += n[1] >= 0 ? -t : t;
+    return n;
+  }
+  static Normal octDecode(double x, double y) { return octDirection(x, y).normalized(); }
+
+  // 由顶点属性的取值范围确定量化参数
+  static VertexQuantizer fit(const Vertices& vertices, const TexCoords& texcoords) {
+    VertexQuantizer q;
+    if (vertices.rows() > 0) {
+      RowVector3 lo = vertices.leftCols<3>().colwise().minCoeff();
+      RowVector3 hi = vertices.leftCols<3>().colwise().maxCoeff();
+      for (int c = 0; c < 3; ++c) {
+        q.positionMatrix(c, c) = (hi[c] - lo[c]) / 65535.0;
+        q.positionMatrix(3, c) = lo[c];
+      }
+    }
+    if (texcoords.rows() > 0) {
+      RowVector2 lo = texcoords.colwise().minCoeff().cwiseMin(0.0);
+      RowVector2 hi = texcoords.colwise().maxCoeff().cwiseMax(1.0);
+      q.uvMin = lo.transpose();
+      q.uvScale = (hi - lo).transpose();
+      q.uvQuantized = q.uvScale.maxCoeff() <= MAX_UV_RANGE;
+    }
+    return q;
+  }
+
+  QuantizedVertices encode(const Vertices& vertices, const Normals& normals,
+                           const TexCoords& texcoords) const {
+    QuantizedVertices q = QuantizedVertices::Zero(vertices.rows(), 8);
+    for (Eigen::Index i = 0; i < vertices.rows(); ++i) {
+      for (int c = 0; c < 3; ++c) {
+        double extent = positionMatrix(c, c) * 65535.0;
+        double x = extent > 0 ? (vertices(i, c) - positionMatrix(3, c)) / extent : 0;
+        q(i, PX + c) = unorm16(x);
+      }
+      if (i < normals.rows()) {
+        Vector2 p = octEncode(normals.row(i));
+        q(i, NX) = snorm16(p[0]);
+        q(i, NY) = snorm16(p[1]);
+      }
+      if (uvQuantized && i < texcoords.rows()) {
+        q(i, U) = unorm16((texcoords(i, 0) - uvMin[0]) / uvScale[0]);
+        q(i, V) = unorm16((texcoords(i, 1) - uvMin[1]) / uvScale[1]);
+      }
+    }
+    return q;
+  }
+
+  Vertice position(const QuantizedVertices& q, Eigen::Index i) const {
+    RowVector4 p(q(i, PX), q(i, PY), q(i, PZ), 1);
+    return (p * positionMatrix).transpose();
+  }
+  Normal normal(const QuantizedVertices& q, Eigen::Index i) const {
+    return octDecode(fromSnorm16(q(i, NX)), fromSnorm16(q(i, NY)));
+  }
+  Normal direction(const QuantizedVertices& q, Eigen::Index i) const {
+    return octDirection(fromSnorm16(q(i, NX)), fromSnorm16(q(i, NY)));
+  }
+  TexCoord texcoord(const QuantizedVertices& q, Eigen::Index i) const {
+    return TexCoord(uvMin[0] + q(i, U) / 65535.0 * uvScale[0],
+                    uvMin[1] + q(i, V) / 65535.0 * uvScale[1]);
+  }
+
+  // uvQuantized 为 false 时不改动 texcoords
+  void decode(const QuantizedVertices& q, Vertices& vertices, Normals& normals,
+              TexCoords& texcoords) const {
+    vertices.resize(q.rows(), 4);
+    normals.resize(q.rows(), 3);
+    if (uvQuantized) texcoords.resize(q.rows(), 2);
+    for (Eigen::Index i = 0; i < q.rows(); ++i) {
+      vertices.row(i) = position(q, i);
+      normals.row(i) = normal(q, i);
+      if (uvQuantized) texcoords.row(i) = texcoord(q, i);
+    }
+  }
+};
+
+}  // namespace qtgl
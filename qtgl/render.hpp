@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QColor>
 #include <QGridLayout>
 #include <QLabel>
 #include <QMouseEvent>
@@ -7,6 +8,7 @@
 #include <QTimer>
 #include <QWheelEvent>
 #include <QWidget>
+#include <algorithm>
 #include <functional>
 #include "scene.hpp"
 
@@ -16,6 +18,62 @@ class GLRenderWidget : public QWidget {
  private:
   GLScene scene;
   std::function<void(GLScene&)> beforeRender = [](GLScene& scene) {};
+  bool statsOverlay = false;
+  GLFrameTimeHistory frameTimes;  // 每次 draw 的耗时
+
+  /*
+  左上角的统计面板: 最近一帧的管线计数与各阶段耗时, 以及最近 GLFrameTimeHistory::CAPACITY 帧的
+  耗时曲线 (每帧一列, 纵轴按其中的最大值缩放) 和 p50 / p95 / p99 参考线
+  */
+  void drawStatsOverlay(QPainter& painter) {
+    const GLFrameStats& s = scene.getFrameStats();
+    QString lines[] = {
+        QString::asprintf("frame %.2f ms  p50 %.2f  p95 %.2f  p99 %.2f", s.totalMs,
+                          frameTimes.percentile(0.5), frameTimes.percentile(0.95),
+                          frameTimes.percentile(0.99)),
+        QString::asprintf("objects    %zu  culled %zu  drawn %zu", s.objects.submitted,
+                          s.objects.culled, s.objects.rasterized),
+        QString::asprintf("groups     %zu  culled %zu  drawn %zu", s.groups.submitted,
+                          s.groups.culled, s.groups.rasterized),
+        QString::asprintf("triangles  %zu  culled %zu  drawn %zu", s.triangles.submitted,
+                          s.triangles.culled, s.triangles.rasterized),
+        QString::asprintf("pixels tested %zu  passed %zu  shaded %zu", s.pixelsTested,
+                          s.depthPassed, s.shadedFragments),
+        QString::asprintf("overdraw %.2f  texture samples %llu  allocations %llu", s.overdraw(),
+                          static_cast<unsigned long long>(s.textureSamples),
+                          static_cast<unsigned long long>(s.allocations)),
+        QString::asprintf("update %.1f  clear %.1f  sort %.1f  transform %.1f", s.updateMs,
+                          s.clearMs, s.sortMs, s.transformMs),
+        QString::asprintf("rasterize %.1f  resolve %.1f ms", s.rasterizeMs, s.resolveMs),
+    };
+    const int left = 8, top = 8, lineHeight = 16, graphHeight = 60;
+    const int graphWidth = static_cast<int>(GLFrameTimeHistory::CAPACITY);
+    const int panelWidth = std::max(graphWidth, 320) + 16;
+    const int lineCount = static_cast<int>(sizeof(lines) / sizeof(lines[0]));
+    const int panelHeight = lineCount * lineHeight + graphHeight + 24;
+    painter.fillRect(left, top, panelWidth, panelHeight, QColor(0, 0, 0, 160));
+
+    painter.setPen(QColor(255, 255, 255));
+    for (int i = 0; i < lineCount; ++i) {
+      painter.drawText(left + 8, top + (i + 1) * lineHeight, lines[i]);
+    }
+
+    int graphTop = top + lineCount * lineHeight + 12;
+    int graphBottom = graphTop + graphHeight;
+    double scale = graphHeight / std::max(frameTimes.max(), 1e-3);
+    painter.setPen(QColor(120, 200, 120));
+    for (size_t i = 0; i < frameTimes.size(); ++i) {
+      int x = left + 8 + static_cast<int>(i);
+      painter.drawLine(x, graphBottom, x, graphBottom - static_cast<int>(frameTimes.at(i) * scale));
+    }
+    const double quantiles[] = {0.5, 0.95, 0.99};
+    const QColor colors[] = {QColor(255, 255, 255), QColor(255, 200, 0), QColor(255, 80, 80)};
+    for (int i = 0; i < 3; ++i) {
+      int y = graphBottom - static_cast<int>(frameTimes.percentile(quantiles[i]) * scale);
+      painter.setPen(colors[i]);
+      painter.drawLine(left + 8, y, left + 8 + graphWidth, y);
+    }
+  }
 
  public:
   GLRenderWidget(QWidget* parent = nullptr) : QWidget(parent) {
@@ -37,6 +95,11 @@ class GLRenderWidget : public QWidget {
 
   GLScene& getScene() { return scene; }
 
+  // 是否在画面上叠加帧统计面板 (见 drawStatsOverlay); 关闭时仍记录帧时间
+  void setStatsOverlay(bool enabled) { statsOverlay = enabled; }
+  bool isStatsOverlay() const { return statsOverlay; }
+  const GLFrameTimeHistory& getFrameTimes() const { return frameTimes; }
+
   void refresh() {
     beforeRender(scene);
     this->update();
@@ -46,6 +109,8 @@ class GLRenderWidget : public QWidget {
     QPainter painter(this);
     painter.eraseRect(0, 0, this->width(), this->height());  // 清除画布
     scene.draw(painter);
+    frameTimes.push(scene.getFrameStats().totalMs);
+    if (statsOverlay) drawStatsOverlay(painter);
   }
 
   void mousePressEvent(QMouseEvent* event) override {
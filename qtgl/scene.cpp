@@ -1,5 +1,7 @@
 #include "scene.hpp"
 #include "mesh.hpp"
+#include <algorithm>
+#include <chrono>
 
 namespace qtgl {
 
@@ -31,28 +33,136 @@ void GLScene::meshTransformToScreen(GLObject* obj) {
   obj->transformVerticesWithMatrix(this->transformMatrix);
 }
 
+bool GLScene::boxInView(const AlignedBox3& box, const Matrix4& mtx) const {
+  if (box.isEmpty()) return false;
+  int outside[5] = {0, 0, 0, 0, 0};
+  for (int c = 0; c < 8; ++c) {
+    Vector3 corner = box.corner(static_cast<AlignedBox3::CornerType>(c));
+    RowVector4 p = RowVector4(corner[0], corner[1], corner[2], 1) * mtx;
+    outside[0] += p[0] < 0;
+    outside[1] += p[0] > viewWidth * p[3];
+    outside[2] += p[1] < 0;
+    outside[3] += p[1] > viewHeight * p[3];
+    outside[4] += p[3] <= 0;
+  }
+  for (int n : outside) {
+    if (n == 8) return false;
+  }
+  return true;
+}
+
+void GLScene::updateGraph() {
+  graph.update([this](GLSceneGraph::NodeId node) {
+    GLObject* obj = graph.getObject(node);
+    if (obj) obj->setModelMatrix(graph.getWorld(node));
+  });
+}
+
+void GLScene::clearFragments() {
+  size_t height = static_cast<size_t>(viewHeight);
+  size_t width = static_cast<size_t>(viewWidth);
+  if (fragments.size() != height || (height > 0 && fragments[0].size() != width)) {
+    fragments = initFragmentsBuffer();
+    return;
+  }
+  for (std::vector<Fragment>& row : fragments) std::fill(row.begin(), row.end(), Fragment::init());
+}
+
 void GLScene::draw(QPainter& painter) {
-  fragments = initFragmentsBuffer();  // TODO clear rather than init new
+  using Clock = std::chrono::steady_clock;
+  auto elapsed = [](Clock::time_point& since) {
+    Clock::time_point now = Clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - since).count();
+    since = now;
+    return ms;
+  };
+  uint64_t allocations = GLAllocationCounter::count();
+  uint64_t textureSamples = GLTextureResidency::instance().sampleCount();
+  Clock::time_point frameStart = Clock::now();
+  Clock::time_point t = frameStart;
+  frameStats = GLFrameStats();
+  updateGraph();
+  frameStats.updateMs = elapsed(t);
+  clearFragments();
+  calculateTransformMatrix();
+  frameStats.clearMs = elapsed(t);
 
-  for (GLObject* obj : objs) {
-    meshTransformToScreen(obj);
-    obj->rasterize(*this);
+  {
+    // 按世界包围盒到相机的距离排序, 没有包围盒的物体排在最后; 距离相同时保持添加顺序.
+    // drawOrder 从帧内存池分配, 须在 reset 之前析构; std::stable_sort 会申请临时缓冲区, 以序号区分
+    struct DrawItem {
+      Scalar distance;
+      size_t index;
+      GLObject* obj;
+    };
+    GLFrameVector<DrawItem> drawOrder{GLArenaAllocator<DrawItem>(frameArena)};
+    drawOrder.reserve(objs.size());
+    Vector3 eye = camera.getPositionVertice().head<3>();
+    for (GLObject* obj : objs) {
+      Scalar distance = 0;
+      if (frontToBack) {
+        AlignedBox3 box = obj->worldBounds();
+        distance = box.isEmpty() ? std::numeric_limits<Scalar>::max()
+                                 : box.squaredExteriorDistance(eye);
+      }
+      drawOrder.push_back({distance, drawOrder.size(), obj});
+    }
+    std::sort(drawOrder.begin(), drawOrder.end(), [](const DrawItem& a, const DrawItem& b) {
+      return a.distance < b.distance || (a.distance == b.distance && a.index < b.index);
+    });
+    frameStats.sortMs = elapsed(t);
+
+    auto drawObjects = [&]() {
+      for (DrawItem& item : drawOrder) {
+        meshTransformToScreen(item.obj);
+        frameStats.transformMs += elapsed(t);
+        item.obj->rasterize(*this);
+        frameStats.rasterizeMs += elapsed(t);
+      }
+    };
+    if (depthPrepass) {
+      rasterPass = GLRasterPass::DEPTH_ONLY;
+      drawObjects();
+      // 几何计数只统计着色阶段
+      frameStats.objects = frameStats.groups = frameStats.triangles = GLCullStats();
+      rasterPass = GLRasterPass::COLOR_EQUAL;
+    }
+    drawObjects();
+    rasterPass = GLRasterPass::COLOR;
+  }
+
+  // 片元写入复用的图像后一次绘制; 未覆盖的像素透明, 保留画布原有的背景
+  int height = static_cast<int>(viewHeight);
+  int width = static_cast<int>(viewWidth);
+  if (frameImage.width() != width || frameImage.height() != height) {
+    frameImage = QImage(width, height, QImage::Format_ARGB32_Premultiplied);
   }
-  for (int h = 0; h < this->viewHeight; ++h) {
-    for (int w = 0; w < this->viewWidth; ++w) {
-      Fragment fragment = fragments[h][w];
+  auto channel = [](Scalar c) -> uint32_t {
+    return static_cast<uint32_t>(std::max<Scalar>(0, std::min<Scalar>(1, c)) * 255);
+  };
+  for (int h = 0; h < height; ++h) {
+    uint32_t* line = reinterpret_cast<uint32_t*>(frameImage.scanLine(h));
+    for (int w = 0; w < width; ++w) {
+      Fragment& fragment = fragments[h][w];
       if (fragment.depth < Fragment::DEPTH_INF) {  // clip
-        QPen oldpen = painter.pen();
-
-        painter.setPen(QPen(QColor(Color01Utils::red(fragment.color) * 255,
-                                   Color01Utils::green(fragment.color) * 255,
-                                   Color01Utils::blue(fragment.color) * 255),
-                            1));
-        painter.drawPoint(w, h);
-        painter.setPen(oldpen);
+        ++frameStats.coveredPixels;
+        line[w] = 0xFF000000u | channel(Color01Utils::red(fragment.color)) << 16 |
+                  channel(Color01Utils::green(fragment.color)) << 8 |
+                  channel(Color01Utils::blue(fragment.color));
+      } else {
+        line[w] = 0;
       }
     }
   }
+  painter.drawImage(0, 0, frameImage);
+  frameStats.resolveMs = elapsed(t);
+
+  // 纹理驻留: 推进帧号, 超出预算时驱逐最久未用的 mip 层
+  GLTextureResidency::instance().endFrame();
+  frameArena.reset();
+  frameStats.textureSamples = GLTextureResidency::instance().sampleCount() - textureSamples;
+  frameStats.allocations = GLAllocationCounter::count() - allocations;
+  frameStats.totalMs = elapsed(frameStart);
 }
 
 }  // namespace qtgl
\ No newline at end of file
@@ -1,32 +1,50 @@
 #pragma once
 
+#include <QImage>
 #include <QPainter>
+#include "arena.hpp"
 #include "camera.hpp"
+#include "framestats.hpp"
 #include "material.hpp"
 #include "projection.hpp"
+#include "scenegraph.hpp"
 #include "shader.hpp"
 
 namespace qtgl {
 
 class GLObject;
 
+// 光栅化所处的阶段, 决定深度测试与是否着色
+enum class GLRasterPass {
+  COLOR,       // 深度小于缓冲区时着色并写入
+  DEPTH_ONLY,  // 深度预渲染: 只写深度, 不建立顶点属性也不着色
+  COLOR_EQUAL  // 深度预渲染之后: 只着色深度与缓冲区完全相等的片元
+};
+
 class GLScene {
  private:
-  double viewHeight;
-  double viewWidth;
+  Scalar viewHeight;
+  Scalar viewWidth;
   GLCamera camera;
   GLProjection projection;
   std::vector<GLObject*> objs;
+  GLSceneGraph graph;
   std::vector<GLLight*> lights;
   Fragments fragments;
   std::map<IlluminationModel, GLShader*> shadermap;
   Color01 ambient = {1, 1, 1, 1};
+  bool frontToBack = true;    // 按到相机的距离由近及远绘制物体
+  bool depthPrepass = false;  // 先只绘制深度, 再只着色可见的片元
+  GLRasterPass rasterPass = GLRasterPass::COLOR;
+  GLFrameStats frameStats;
+  GLFrameArena frameArena;  // 一帧内的临时数据, draw 结束时 reset
+  QImage frameImage;        // 片元缓冲区转换为图像后一次绘制, 尺寸不变时复用
 
-  Eigen::Matrix4d transformMatrix;
-  Eigen::Matrix4d invTransformMatrix;
+  Matrix4 transformMatrix;
+  Matrix4 invTransformMatrix;
 
  public:
-  GLScene(double viewHeight = 768.0, double viewWidth = 1024.0)
+  GLScene(Scalar viewHeight = 768.0, Scalar viewWidth = 1024.0)
       : viewHeight(viewHeight), viewWidth(viewWidth) {
     this->projection.height = viewHeight;
     this->projection.width = viewWidth;
@@ -38,15 +56,15 @@ class GLScene {
   GLCamera& getCamera() { return this->camera; }
   Fragments& getFragments() { return this->fragments; }
   GLProjection& getProjection() { return this->projection; }
-  void setViewHeight(double h) {
+  void setViewHeight(Scalar h) {
     this->viewHeight = h;
     this->projection.height = h;
   }
-  void setViewWidth(double w) {
+  void setViewWidth(Scalar w) {
     this->viewWidth = w;
     this->projection.width = w;
   }
-  void setViewSize(double w, double h) {
+  void setViewSize(Scalar w, Scalar h) {
     this->setViewWidth(w);
     this->setViewHeight(h);
   }
@@ -55,15 +73,41 @@ class GLScene {
   void setAmbient(Color01 ambient) { this->ambient = ambient; }
   Color01 getAmbient() const { return this->ambient; }
 
+  /*
+  绘制顺序: 由近及远绘制时先画的近处表面使远处的片元在深度测试中被拒绝, 减少着色次数;
+  开启深度预渲染后每个像素至多着色一次 (深度相等的重叠片元除外), 代价是所有物体光栅化两遍
+  */
+  void setFrontToBack(bool enabled) { frontToBack = enabled; }
+  bool isFrontToBack() const { return frontToBack; }
+  void setDepthPrepass(bool enabled) { depthPrepass = enabled; }
+  bool isDepthPrepass() const { return depthPrepass; }
+  GLRasterPass getRasterPass() const { return rasterPass; }
+  // 最近一次 draw 的管线统计; 光栅化过程中由各物体累加
+  GLFrameStats& getFrameStats() { return frameStats; }
+  // draw 结束时 reset; 在 draw 之外直接调用物体的 rasterize 时由调用者 reset
+  GLFrameArena& getFrameArena() { return frameArena; }
+
   void addObj(GLObject* obj) { objs.push_back(obj); }
+  /*
+  添加物体并挂到场景层次的 parent 节点下, 返回其节点; 物体的模型矩阵此后由层次中的世界矩阵决定,
+  修改 local 使用 getGraph().setLocal. 不绘制的节点 (如关节) 用 getGraph().addNode 添加
+  */
+  GLSceneGraph::NodeId addObj(GLObject* obj, GLSceneGraph::NodeId parent,
+                              const Matrix4& local = Matrix4::Identity()) {
+    objs.push_back(obj);
+    return graph.addNode(parent, local, obj);
+  }
+  GLSceneGraph& getGraph() { return graph; }
+  // 重新计算变化的世界矩阵并写入绑定物体的模型矩阵, draw 开始时自动调用
+  void updateGraph();
   void addLight(GLLight* lgt) { lights.push_back(lgt); }
   std::vector<GLLight*>& getLights() { return this->lights; }
   std::vector<GLObject*>& getObjs() { return this->objs; }
 
-  Eigen::Matrix4d viewportMatrix() {
-    double hw = this->viewWidth / 2;
-    double hh = this->viewHeight / 2;
-    Eigen::Matrix4d viewMtx;
+  Matrix4 viewportMatrix() {
+    Scalar hw = this->viewWidth / 2;
+    Scalar hh = this->viewHeight / 2;
+    Matrix4 viewMtx;
     viewMtx << hw, 0, 0, 0,  //
         0, hh, 0, 0,         //
         0, 0, 1, 0,          //
@@ -78,8 +122,19 @@ class GLScene {
     invTransformMatrix = transformMatrix.inverse();
   }
 
+  // 世界坐标 -> 屏幕坐标 (齐次) 的变换矩阵, 由 calculateTransformMatrix 更新
+  const Matrix4& getTransformMatrix() const { return transformMatrix; }
+
+  /*
+  包围盒经 mtx (模型矩阵 * 变换矩阵) 变换后是否可能可见, 用于剔除
+  屏幕齐次坐标下取 0 <= x <= width * w, 0 <= y <= height * w 及相机前方 w > 0 共 5 个面,
+  8 个角点都在同一个面外侧时不可见, 其余情况保守地视为可见.
+  光栅化不按深度裁剪, 远近平面外的物体仍会绘制, 因此这里也不检查
+  */
+  bool boxInView(const AlignedBox3& box, const Matrix4& mtx) const;
+
   // screen coordinator back to world coordinator
-  Vertice screenVerticeBackToWorldVertice(double x, double y, double z, double w) {
+  Vertice screenVerticeBackToWorldVertice(Scalar x, Scalar y, Scalar z, Scalar w) {
     return screenVerticeBackToWorldVertice({x, y, z, w});
   }
 
@@ -91,10 +146,39 @@ class GLScene {
 
   void meshTransformToScreen(GLObject* obj);
 
+  /*
+  离屏绘制: 临时以 offscreenCamera 与 transform (世界坐标 -> target 的屏幕坐标) 替换当前的相机与
+  变换矩阵, 以 target 为片元缓冲区调用 render(), 返回前全部恢复.
+  期间按普通着色阶段光栅化, 不计入帧统计; 光源与着色器沿用本场景
+  */
+  template <typename F>
+  void renderOffscreen(const GLCamera& offscreenCamera, const Matrix4& transform,
+                       Fragments& target, F render) {
+    GLCamera savedCamera = camera;
+    Matrix4 savedTransform = transformMatrix;
+    Matrix4 savedInverse = invTransformMatrix;
+    GLRasterPass savedPass = rasterPass;
+    GLFrameStats savedStats = frameStats;
+    std::swap(fragments, target);
+    camera = offscreenCamera;
+    transformMatrix = transform;
+    invTransformMatrix = transform.inverse();
+    rasterPass = GLRasterPass::COLOR;
+    render();
+    std::swap(fragments, target);
+    camera = savedCamera;
+    transformMatrix = savedTransform;
+    invTransformMatrix = savedInverse;
+    rasterPass = savedPass;
+    frameStats = savedStats;
+  }
+
   Fragments initFragmentsBuffer() {
     Fragments fs(this->viewHeight, std::vector<Fragment>(this->viewWidth, Fragment::init()));
     return fs;
   }
+  // 尺寸不变时原地清空片元缓冲区, 不重新分配
+  void clearFragments();
 
   void draw(QPainter& painter);
 };
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "define.hpp"
+
+namespace qtgl {
+
+class GLObject;
+
+/*
+场景层次: 节点的局部矩阵逐级组合为世界矩阵 (行向量约定, world = local * parent.world)
+  - 节点按拓扑顺序连续存放 (父节点的序号总小于子节点), 各属性分别存放在数组中,
+    update 只需顺序扫描一遍, 不做递归, 也不追随指针
+  - setLocal 只标记节点; update 时只重新计算标记过的节点及其子树, 其余节点的世界矩阵沿用缓存
+  - 节点可绑定一个 GLObject, 世界矩阵变化时由 GLScene 写入其模型矩阵
+节点只能追加 (父节点须已存在) 而不能移动, 因此拓扑顺序始终成立
+*/
+class GLSceneGraph {
+ public:
+  using NodeId = int;
+  constexpr static NodeId ROOT = -1;  // 作为父节点时表示没有父节点
+
+ private:
+  std::vector<NodeId> parents;
+  std::vector<Matrix4> locals;
+  std::vector<Matrix4> worlds;
+  std::vector<uint8_t> dirty;    // 局部矩阵在上次 update 后被修改
+  std::vector<uint8_t> changed;  // 世界矩阵在最近一次 update 中被重新计算
+  std::vector<GLObject*> objects;
+  std::vector<std::string> names;
+  bool anyDirty = false;
+  bool anyChanged = false;
+
+ public:
+  NodeId addNode(NodeId parent, const Matrix4& local = Matrix4::Identity(),
+                 GLObject* object = nullptr, const std::string& name = "") {
+    if (parent < ROOT || parent >= size()) parent = ROOT;
+    parents.push_back(parent);
+    locals.push_back(local);
+    worlds.push_back(parent == ROOT ? local : Matrix4(local * worlds[parent]));
+    dirty.push_back(1);
+    changed.push_back(0);
+    objects.push_back(object);
+    names.push_back(name);
+    anyDirty = true;
+    return size() - 1;
+  }
+
+  int size() const { return static_cast<int>(parents.size()); }
+  void reserve(size_t n) {
+    parents.reserve(n);
+    locals.reserve(n);
+    worlds.reserve(n);
+    dirty.reserve(n);
+    changed.reserve(n);
+    objects.reserve(n);
+    names.reserve(n);
+  }
+  void clear() { *this = GLSceneGraph(); }
+
+  NodeId getParent(NodeId node) const { return parents[node]; }
+  GLObject* getObject(NodeId node) const { return objects[node]; }
+  void setObject(NodeId node, GLObject* object) {
+    objects[node] = object;
+    dirty[node] = 1;
+    anyDirty = true;
+  }
+  const std::string& getName(NodeId node) const { return names[node]; }
+  // 按名称查找第一个匹配的节点, 不存在时返回 ROOT
+  NodeId find(const std::string& name) const {
+    for (NodeId i = 0; i < size(); ++i) {
+      if (names[i] == name) return i;
+    }
+    return ROOT;
+  }
+
+  const Matrix4& getLocal(NodeId node) const { return locals[node]; }
+  void setLocal(NodeId node, const Matrix4& local) {
+    locals[node] = local;
+    dirty[node] = 1;
+    anyDirty = true;
+  }
+  // 最近一次 update 后的世界矩阵
+  const Matrix4& getWorld(NodeId node) const { return worlds[node]; }
+  bool isChanged(NodeId node) const { return changed[node] != 0; }
+
+  /*
+  重新计算被修改的节点及其子树的世界矩阵, 对每个重新计算的节点调用 onChanged(node)
+  没有节点被修改时直接返回
+  */
+  template <typename F>
+  void update(F onChanged) {
+    if (!anyDirty) {
+      if (anyChanged) std::fill(changed.begin(), changed.end(), 0);
+      anyChanged = false;
+      return;
+    }
+    NodeId n = size();
+    for (NodeId i = 0; i < n; ++i) {
+      NodeId p = parents[i];
+      bool recompute = dirty[i] || (p != ROOT && changed[p]);
+      changed[i] = recompute;
+      if (!recompute) continue;
+      if (p == ROOT) {
+        worlds[i] = locals[i];
+      } else {
+        worlds[i].noalias() = locals[i] * worlds[p];
+      }
+      dirty[i] = 0;
+      onChanged(i);
+    }
+    anyDirty = false;
+    anyChanged = true;
+  }
+  void update() {
+    update([](NodeId) {});
+  }
+};
+
+}  // namespace qtgl
@@ -3,69 +3,79 @@
 #include <algorithm>
 #include <cmath>
 #include "define.hpp"
+#include "fastmath.hpp"
 #include "material.hpp"
 
 namespace qtgl {
 
 struct GLLight {
   Color01 intensity;
-  virtual Eigen::Vector3d uvLight(Vertice& pos) = 0;  // l unit vector
+  virtual Vector3 uvLight(Vertice& pos) = 0;  // l unit vector
 };
 
 struct DirectionalGLLight : public GLLight {
-  Eigen::Vector3d d;  // direction
-  Eigen::Vector3d uvLight(Vertice& pos) { return (d * -1).normalized(); }
+  Vector3 d;  // direction
+  Vector3 uvLight(Vertice& pos) { return ShadeMath::normalized(d * -1); }
 };
 
 struct PointGLLight : public GLLight {
   Vertice position;
-  Eigen::Vector3d uvLight(Vertice& pos) { return (position - pos).head(3).normalized(); }
+  Vector3 uvLight(Vertice& pos) {
+    return ShadeMath::normalized((position - pos).head(3));
+  }
 };
 
 struct GLShader {
   virtual Color01 shade(std::vector<GLLight*>& lights, Color01 ambient, GLMaterial* material,
-                        Vertice& position, Eigen::Vector3d& uvNormal, Eigen::Vector3d& uvView,
-                        TexCoord* coord) = 0;
+                        Vertice& position, Vector3& uvNormal, Vector3& uvView, TexCoord* coord,
+                        TexCoordDerivs* derivs = nullptr) = 0;
 };
 
 struct LambertianGLShader : public GLShader {
   Color01 shade(std::vector<GLLight*>& lights, Color01 ambient, GLMaterial* material,
-                Vertice& position, Eigen::Vector3d& uvNormal, Eigen::Vector3d& uvView,
-                TexCoord* coord) {
-    Eigen::Vector3d uvLight;
+                Vertice& position, Vector3& uvNormal, Vector3& uvView, TexCoord* coord,
+                TexCoordDerivs* derivs = nullptr) {
+    Vector3 uvLight;
     Color01 r(0, 0, 0, 0);
-    r = r + ambient.cwiseProduct(material->getAmbient(coord));
+    r = r + ambient.cwiseProduct(material->getAmbient(coord, derivs));
     Color01 p(0, 0, 0, 0);
     for (GLLight* light : lights) {
       uvLight = light->uvLight(position);
-      p = p + (std::max(0.0, uvLight.dot(uvNormal)))*light->intensity;
+      p = p + (std::max<Scalar>(0, uvLight.dot(uvNormal)))*light->intensity;
     }
-    r = r + p.cwiseProduct(material->getDiffuse(coord));
+    r = r + p.cwiseProduct(material->getDiffuse(coord, derivs));
     return r;
   }
 };
-struct LambertialBlinnPhongGLShader : public GLShader {
+/*
+tier 决定高光项的 pow 及半程向量归一化所用的实现, 见 fastmath.hpp
+*/
+template <MathTier tier>
+struct LambertialBlinnPhongGLShaderT : public GLShader {
   Color01 shade(std::vector<GLLight*>& lights, Color01 ambient, GLMaterial* material,
-                Vertice& position, Eigen::Vector3d& uvNormal, Eigen::Vector3d& uvView,
-                TexCoord* coord) {
-    Eigen::Vector3d uvLight;
-    Eigen::Vector3d uvHalf;
+                Vertice& position, Vector3& uvNormal, Vector3& uvView, TexCoord* coord,
+                TexCoordDerivs* derivs = nullptr) {
+    Vector3 uvLight;
+    Vector3 uvHalf;
     Color01 r(0, 0, 0, 0);
-    r = r + ambient.cwiseProduct(material->getAmbient(coord));
+    r = r + ambient.cwiseProduct(material->getAmbient(coord, derivs));
     Color01 d(0, 0, 0, 0);
     Color01 s(0, 0, 0, 0);
     for (GLLight* light : lights) {
       uvLight = light->uvLight(position);
-      uvHalf = (uvView + uvLight).normalized();
-      d = d + (std::max(0.0, uvLight.dot(uvNormal)))*light->intensity;
-      s = s + std::pow(std::max(0.0, uvHalf.dot(uvNormal)), material->getSpecularHighlight()) *
+      uvHalf = ShadeMathT<tier>::normalized(uvView + uvLight);
+      d = d + (std::max<Scalar>(0, uvLight.dot(uvNormal)))*light->intensity;
+      s = s + ShadeMathT<tier>::pow(material->getSpecularLUT(),
+                                    std::max<Scalar>(0, uvHalf.dot(uvNormal))) *
                   light->intensity;
     }
-    r = r + d.cwiseProduct(material->getDiffuse(coord));
+    r = r + d.cwiseProduct(material->getDiffuse(coord, derivs));
     r = r + s.cwiseProduct(material->getSpecular());
     r = Color01Utils::clamp(r);
     return r;
   }
 };
 
+using LambertialBlinnPhongGLShader = LambertialBlinnPhongGLShaderT<kMathTier>;
+
 }  // namespace qtgl
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include <iostream>
+
+/*
+测试程序共用的检查: 逐项输出结果并记录失败次数, main 末尾以 finish() 输出 PASSED / FAILED
+并作为进程的返回值
+*/
+
+inline int failures = 0;
+
+inline void expect(const char* name, bool ok) {
+  std::cout << name << ": " << (ok ? "ok" : "FAILED") << std::endl;
+  if (!ok) ++failures;
+}
+
+// 误差类检查: 输出数值与上限, 超过上限 (或为 NaN) 时失败
+inline void expectLE(const char* name, double value, double bound) {
+  std::cout << name << ": " << value << " (bound " << bound << ")" << std::endl;
+  if (!(value <= bound)) {
+    std::cout << "  FAILED" << std::endl;
+    ++failures;
+  }
+}
+
+inline int finish() {
+  std::cout << (failures ? "FAILED" : "PASSED") << std::endl;
+  return failures ? 1 : 0;
+}
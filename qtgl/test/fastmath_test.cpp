@@ -0,0 +1,113 @@
+#include "../fastmath.hpp"
+#include <iostream>
+#include "../shader.hpp"
+#include "expect.hpp"
+
+/*
+1. 各近似函数在有效输入范围上的最大误差不超过 fastmath.hpp 中给出的值
+2. EXACT / FAST 两档着色器渲染同一球体, 逐像素比较颜色差异
+*/
+
+static void testFunctions() {
+  using qtgl::FastMath;
+  double e = 0;
+  for (double x = -60; x <= 60; x += 1.37e-4) {
+    e = std::max(e, std::fabs(FastMath::exp2(x) - std::exp2(x)) / std::exp2(x));
+  }
+  expectLE("exp2 max rel error", e, 1e-8);
+
+  e = 0;
+  for (double x = -700; x <= 700; x += 1.37e-3) {
+    e = std::max(e, std::fabs(FastMath::exp(x) - std::exp(x)) / std::exp(x));
+  }
+  expectLE("exp max rel error", e, 1e-8);
+
+  double el2 = 0, el = 0, er = 0;
+  for (double x = 1e-300; x < 1e300; x *= 1.0001371) {
+    el2 = std::max(el2, std::fabs(FastMath::log2(x) - std::log2(x)));
+    el = std::max(el, std::fabs(FastMath::log(x) - std::log(x)));
+    double r = 1 / std::sqrt(x);
+    er = std::max(er, std::fabs(FastMath::rsqrt(x) - r) / r);
+  }
+  expectLE("log2 max abs error", el2, 2e-9);
+  expectLE("log max abs error", el, 1e-9);
+  expectLE("rsqrt max rel error", er, 5e-6);
+
+  e = 0;
+  for (double x = 1e-6; x <= 1; x += 1.37e-6) {
+    for (double y : {1.0, 2.0, 10.0, 64.0, 160.0, 1000.0}) {
+      if (std::fabs(y * std::log2(x)) > 64) continue;
+      double p = std::pow(x, y);
+      e = std::max(e, std::fabs(FastMath::pow(x, y) - p) / p);
+    }
+  }
+  expectLE("pow max rel error", e, 1e-7);
+
+  e = 0;
+  for (double n : {1.0, 2.0, 10.717731, 121.257324, 159.999985, 1000.0, 5000.0}) {
+    qtgl::SpecularPowLUT lut(n);
+    for (double x = 0; x <= 1; x += 1e-7) {
+      e = std::max(e, std::fabs(lut.pow(x) - std::pow(x, n)));
+    }
+  }
+  expectLE("SpecularPowLUT max abs error", e, qtgl::SpecularPowLUT::CUTOFF);
+}
+
+// 以给定着色器渲染一个单位球, 返回 size*size 个像素颜色
+static std::vector<qtgl::Color01> renderSphere(qtgl::GLShader& shader, qtgl::GLMaterial& material,
+                                               int size) {
+  std::vector<qtgl::GLLight*> lights;
+  qtgl::PointGLLight lgt;
+  lgt.intensity = {1, 1, 1, 1};
+  lgt.position = {-3, 3, 5, 1};
+  lights.push_back(&lgt);
+  qtgl::Color01 ambient(0.2, 0.2, 0.2, 1);
+  qtgl::Vector3 eye(0, 0, 5);
+
+  std::vector<qtgl::Color01> image(size * size, qtgl::Color01(0, 0, 0, 0));
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      double u = 2.0 * (x + 0.5) / size - 1;
+      double v = 1 - 2.0 * (y + 0.5) / size;
+      double w2 = 1 - u * u - v * v;
+      if (w2 < 0) continue;
+      qtgl::Vector3 normal(u, v, std::sqrt(w2));
+      qtgl::Vertice position(u, v, normal[2], 1);
+      qtgl::Vector3 view = (eye - normal).normalized();
+      image[y * size + x] =
+          shader.shade(lights, ambient, &material, position, normal, view, nullptr);
+    }
+  }
+  return image;
+}
+
+static void testImageDifference() {
+  const int size = 256;
+  qtgl::LambertialBlinnPhongGLShaderT<qtgl::MathTier::EXACT> exact;
+  qtgl::LambertialBlinnPhongGLShaderT<qtgl::MathTier::FAST> fast;
+  // F16fin.mtl 中出现的高光指数
+  for (double ns : {10.717731, 121.257324, 159.999985, 1000.0}) {
+    qtgl::GLMaterial material;
+    material.setAmbient({0.3, 0.3, 0.3, 1});
+    material.setDiffuse({0.6, 0.5, 0.4, 1});
+    material.setSpecular({1, 1, 1, 1});
+    material.setSpecularHighlight(ns);
+    std::vector<qtgl::Color01> a = renderSphere(exact, material, size);
+    std::vector<qtgl::Color01> b = renderSphere(fast, material, size);
+    double maxDiff = 0, sumDiff = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+      double d = (a[i] - b[i]).cwiseAbs().maxCoeff();
+      maxDiff = std::max(maxDiff, d);
+      sumDiff += d;
+    }
+    std::cout << "Ns " << ns << " mean diff: " << sumDiff / a.size() << std::endl;
+    // 误差应小于 8 位颜色的一个量化步长
+    expectLE("  FAST vs EXACT max pixel diff", maxDiff, 1.0 / 255);
+  }
+}
+
+int main() {
+  testFunctions();
+  testImageDifference();
+  return finish();
+}
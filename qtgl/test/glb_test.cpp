@@ -0,0 +1,92 @@
+#include "../glbloader.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "expect.hpp"
+
+/*
+一个网格的两个图元共用 POSITION / NORMAL 访问器, 第一个没有材质, 第二个的材质索引越界:
+1. 两个图元的每个面都能取到材质, 且为规范的默认材质 (基础色 1, 金属度 1)
+2. 共用的访问器只写入一次, 焊接后只有 4 个顶点
+*/
+
+static void append(std::vector<uint8_t>& out, const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  out.insert(out.end(), p, p + size);
+}
+
+static void writeGlb(const std::string& path) {
+  std::string json = R"({
+    "asset": {"version": "2.0"},
+    "scene": 0,
+    "scenes": [{"nodes": [0]}],
+    "nodes": [{"mesh": 0}],
+    "meshes": [{"name": "quad", "primitives": [
+      {"attributes": {"POSITION": 0, "NORMAL": 1}, "indices": 2},
+      {"attributes": {"POSITION": 0, "NORMAL": 1}, "indices": 3, "material": 5}
+    ]}],
+    "materials": [{"name": "red", "pbrMetallicRoughness": {"baseColorFactor": [1, 0, 0, 1]}}],
+    "buffers": [{"byteLength": 112}],
+    "bufferViews": [
+      {"buffer": 0, "byteOffset": 0, "byteLength": 96},
+      {"buffer": 0, "byteOffset": 96, "byteLength": 16}
+    ],
+    "accessors": [
+      {"bufferView": 0, "byteOffset": 0, "componentType": 5126, "count": 4, "type": "VEC3"},
+      {"bufferView": 0, "byteOffset": 48, "componentType": 5126, "count": 4, "type": "VEC3"},
+      {"bufferView": 1, "byteOffset": 0, "componentType": 5123, "count": 3, "type": "SCALAR"},
+      {"bufferView": 1, "byteOffset": 8, "componentType": 5123, "count": 3, "type": "SCALAR"}
+    ]
+  })";
+  json.resize((json.size() + 3) & ~size_t(3), ' ');
+
+  std::vector<uint8_t> bin;
+  float positions[] = {0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0};
+  float normals[] = {0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1};
+  uint16_t indices[] = {0, 1, 2, 0, 2, 1, 3, 0};  // 第二组索引从第 8 字节开始
+  append(bin, positions, sizeof(positions));
+  append(bin, normals, sizeof(normals));
+  append(bin, indices, sizeof(indices));
+
+  std::vector<uint8_t> glb;
+  uint32_t header[] = {0x46546C67, 2, static_cast<uint32_t>(12 + 8 + json.size() + 8 + bin.size())};
+  uint32_t jsonChunk[] = {static_cast<uint32_t>(json.size()), 0x4E4F534A};
+  uint32_t binChunk[] = {static_cast<uint32_t>(bin.size()), 0x004E4942};
+  append(glb, header, sizeof(header));
+  append(glb, jsonChunk, sizeof(jsonChunk));
+  append(glb, json.data(), json.size());
+  append(glb, binChunk, sizeof(binChunk));
+  append(glb, bin.data(), bin.size());
+  std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(glb.data()),
+                                               static_cast<std::streamsize>(glb.size()));
+}
+
+int main() {
+  const std::string path = "glb_test.glb";
+  writeGlb(path);
+  qtgl::GLMesh* mesh = qtgl::GlbLoader::load(path);
+  std::remove(path.c_str());
+  expect("glb loaded", mesh != nullptr);
+  if (!mesh) return finish();
+
+  bool resolved = mesh->getGroups().size() == 2;
+  bool specDefault = true;
+  for (auto& g : mesh->getGroups()) {
+    for (qtgl::MaterialId id : g.second->getMaterialIds()) {
+      qtgl::GLMaterial* material = mesh->getMaterial(id);
+      resolved = resolved && material != nullptr;
+      if (!material) continue;
+      specDefault = specDefault && material->getDiffuse() == qtgl::Color01(1, 1, 1, 1) &&
+                    material->getSpecular() == qtgl::Color01(1, 1, 1, 1);
+    }
+  }
+  expect("every face has a material", resolved);
+  expect("missing / out-of-range material uses the spec default", specDefault);
+  expect("shared accessors are written once", mesh->getVertices().rows() == 4);
+
+  delete mesh;
+  return finish();
+}
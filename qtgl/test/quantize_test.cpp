@@ -0,0 +1,66 @@
+#include "../quantize.hpp"
+#include <iostream>
+#include <limits>
+#include <random>
+#include "expect.hpp"
+
+/*
+1. 位置误差不超过包围盒各轴边长的 1/131070
+2. 八面体编码的法线角度误差不超过 2e-4 弧度, 覆盖两个半球及坐标轴方向
+3. [0, 1] 内纹理坐标的误差不超过 1/131070, 超出 [0, 1] 时按实际范围量化, 范围过大时不量化
+*/
+
+int main() {
+  const int n = 100000;
+  const double slack = 16 * std::numeric_limits<qtgl::Scalar>::epsilon();  // 标量类型本身的舍入
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> pos(-250, 1000), dir(-1, 1), uv(0, 1);
+
+  qtgl::Vertices vertices(n, 4);
+  qtgl::Normals normals(n, 3);
+  qtgl::TexCoords texcoords(n, 2);
+  for (int i = 0; i < n; ++i) {
+    vertices.row(i) << pos(gen), 0.01 * pos(gen), 5.0, 1;  // z 轴范围为 0
+    qtgl::Normal d(dir(gen), dir(gen), dir(gen));
+    if (i < 6) d = qtgl::Normal::Unit(i / 2) * (i % 2 ? -1 : 1);
+    normals.row(i) = d.normalized();
+    texcoords.row(i) << uv(gen), uv(gen);
+  }
+
+  qtgl::VertexQuantizer quantizer = qtgl::VertexQuantizer::fit(vertices, texcoords);
+  qtgl::QuantizedVertices q = quantizer.encode(vertices, normals, texcoords);
+  qtgl::Vertices v2;
+  qtgl::Normals n2;
+  qtgl::TexCoords t2;
+  quantizer.decode(q, v2, n2, t2);
+
+  qtgl::RowVector3 extent = vertices.leftCols<3>().colwise().maxCoeff() -
+                            vertices.leftCols<3>().colwise().minCoeff();
+  double ep = 0, en = 0, et = 0;
+  for (int i = 0; i < n; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      double e = std::fabs(v2(i, c) - vertices(i, c));
+      ep = std::max(ep, extent[c] > 0 ? e / extent[c] : e);
+    }
+    Eigen::Vector3d a = n2.row(i).cast<double>(), b = normals.row(i).cast<double>();
+    en = std::max(en, std::atan2(a.cross(b).norm(), a.dot(b)));
+    et = std::max<double>(et, (t2.row(i) - texcoords.row(i)).cwiseAbs().maxCoeff());
+  }
+  expectLE("position max error / extent", ep, 1.0 / 131070 + slack);
+  expectLE("normal max angle error", en, 2e-4);
+  expectLE("texcoord max error", et, 1.0 / 131070 + slack);
+
+  // 重复寻址的纹理坐标
+  texcoords.col(0) *= 4;
+  quantizer = qtgl::VertexQuantizer::fit(vertices, texcoords);
+  quantizer.decode(quantizer.encode(vertices, normals, texcoords), v2, n2, t2);
+  expectLE("wrapped texcoord max error", (t2 - texcoords).cwiseAbs().maxCoeff(),
+           4.0 / 131070 + slack);
+
+  // 范围过大时不量化纹理坐标
+  texcoords.col(1) *= 100;
+  quantizer = qtgl::VertexQuantizer::fit(vertices, texcoords);
+  expect("texcoords with range 100 not quantized", !quantizer.uvQuantized);
+
+  return finish();
+}
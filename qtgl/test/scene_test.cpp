@@ -3,12 +3,12 @@
 int main() {
   qtgl::GLScene scene;
 
-  Eigen::Matrix4d projmtx = scene.getProjection().projMatrix();
-  Eigen::Matrix4d viewmtx = scene.getCamera().viewMatrix();
-  Eigen::Matrix4d viewportmtx = scene.viewportMatrix();
+  qtgl::Matrix4 projmtx = scene.getProjection().projMatrix();
+  qtgl::Matrix4 viewmtx = scene.getCamera().viewMatrix();
+  qtgl::Matrix4 viewportmtx = scene.viewportMatrix();
 
-  Eigen::Matrix4d transformMtx = viewmtx * projmtx * viewportmtx;
-  Eigen::Matrix4d invTransformMtx = transformMtx.inverse();
+  qtgl::Matrix4 transformMtx = viewmtx * projmtx * viewportmtx;
+  qtgl::Matrix4 invTransformMtx = transformMtx.inverse();
 
   qtgl::Vertice v0(117, 32, 10, 1);
   std::cout << v0 << std::endl;
@@ -0,0 +1,76 @@
+#include "../scenegraph.hpp"
+#include <iostream>
+#include <random>
+#include "../affineutils.hpp"
+#include "expect.hpp"
+
+/*
+1. 世界矩阵等于从根到节点的局部矩阵依次相乘
+2. 修改一个节点的局部矩阵后, update 只重新计算该节点的子树
+3. 没有修改时 update 不重新计算任何节点
+*/
+
+// 沿父节点链直接相乘
+static qtgl::Matrix4 reference(const qtgl::GLSceneGraph& graph, int node) {
+  qtgl::Matrix4 m = graph.getLocal(node);
+  for (int p = graph.getParent(node); p != qtgl::GLSceneGraph::ROOT; p = graph.getParent(p)) {
+    m = m * graph.getLocal(p);
+  }
+  return m;
+}
+
+static bool worldsMatch(const qtgl::GLSceneGraph& graph) {
+  for (int i = 0; i < graph.size(); ++i) {
+    if (!graph.getWorld(i).isApprox(reference(graph, i), 1e-5)) return false;
+  }
+  return true;
+}
+
+int main() {
+  const int n = 10000;
+  std::mt19937 gen(11);
+  std::uniform_real_distribution<double> angle(-3, 3), offset(-10, 10);
+  auto randomLocal = [&]() -> qtgl::Matrix4 {
+    return qtgl::AffineUtils::rotateYMtx(angle(gen)) *
+           qtgl::AffineUtils::translateMtx(offset(gen), offset(gen), offset(gen));
+  };
+
+  qtgl::GLSceneGraph graph;
+  graph.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    // 父节点取之前的任意节点, 层次深浅不一
+    int parent = i == 0 ? qtgl::GLSceneGraph::ROOT : static_cast<int>(gen() % i);
+    graph.addNode(parent, randomLocal());
+  }
+  int recomputed = 0;
+  graph.update([&recomputed](int) { ++recomputed; });
+  expect("initial update recomputes all nodes", recomputed == n);
+  expect("world matrices after initial update", worldsMatch(graph));
+
+  int target = n / 3;
+  std::vector<bool> inSubtree(n, false);
+  inSubtree[target] = true;
+  int subtree = 1;
+  for (int i = target + 1; i < n; ++i) {
+    if (inSubtree[graph.getParent(i)]) {
+      inSubtree[i] = true;
+      ++subtree;
+    }
+  }
+  graph.setLocal(target, randomLocal());
+  recomputed = 0;
+  bool onlySubtree = true;
+  graph.update([&](int node) {
+    ++recomputed;
+    onlySubtree = onlySubtree && inSubtree[node];
+  });
+  expect("update recomputes only the modified subtree", onlySubtree && recomputed == subtree);
+  expect("world matrices after partial update", worldsMatch(graph));
+
+  recomputed = 0;
+  graph.update([&recomputed](int) { ++recomputed; });
+  expect("update without changes recomputes nothing",
+         recomputed == 0 && !graph.isChanged(target));
+
+  return finish();
+}
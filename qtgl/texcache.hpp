@@ -0,0 +1,123 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "texture.hpp"
+
+namespace qtgl {
+
+enum class GLTextureLoadPolicy {
+  EAGER,  // acquire 时立即提交解码
+  LAZY    // 首次采样时才解码, 见 GLTextureResidency
+};
+
+/*
+进程级纹理缓存
+  - 以规范化后的绝对路径为键, 同一图像文件只解码、存储一次
+  - 返回 shared_ptr 作为引用计数句柄, 材质 / 网格副本共享同一纹理
+  - 缓存本身只持有 weak_ptr, 最后一个句柄释放时纹理随之释放
+  - 纹理在共享线程池中并行解码, acquire 立即返回; 解码完成前材质以自身颜色占位
+  - 驻留与驱逐由 GLTextureResidency 管理
+*/
+class GLTextureCache {
+ private:
+  std::mutex mtx;
+  std::map<std::string, std::weak_ptr<GLTexture>> textures;
+  GLTextureLoadPolicy policy = GLTextureLoadPolicy::LAZY;
+  GLTexelFormat format = GLTexelFormat::RGBA8;
+
+  GLTextureCache() = default;
+
+ public:
+  GLTextureCache(const GLTextureCache&) = delete;
+  GLTextureCache& operator=(const GLTextureCache&) = delete;
+
+  static GLTextureCache& instance() {
+    static GLTextureCache cache;
+    return cache;
+  }
+
+  static std::string canonicalPath(const std::string& path) {
+    std::error_code ec;
+    std::filesystem::path p = std::filesystem::weakly_canonical(path, ec);
+    if (ec) {
+      p = std::filesystem::absolute(path, ec).lexically_normal();
+    }
+    return p.make_preferred().string();
+  }
+
+  void setLoadPolicy(GLTextureLoadPolicy policy) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->policy = policy;
+  }
+
+  // 之后新建纹理使用的纹素格式, 已缓存的纹理不受影响
+  void setTexelFormat(GLTexelFormat format) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->format = format;
+  }
+
+  // 获取纹理句柄, 未缓存时按加载策略创建
+  std::shared_ptr<GLTexture> acquire(const std::string& path) {
+    std::string key = canonicalPath(path);
+    std::lock_guard<std::mutex> lock(mtx);
+    std::shared_ptr<GLTexture> texture = textures[key].lock();
+    if (!texture) {
+      if (policy == GLTextureLoadPolicy::EAGER) {
+        texture = InterpolateGLTexture::loadAsync(key, ThreadPool::shared(), true, format);
+      } else {
+        texture = InterpolateGLTexture::loadLazy(key, ThreadPool::shared(), true, format);
+      }
+      textures[key] = texture;
+    }
+    return texture;
+  }
+
+  /*
+  获取内嵌图像纹理, key 为调用方给出的唯一标识 (如 "<glb 绝对路径>#image<序号>")
+  未缓存时以 encoded 创建, 否则忽略 encoded 直接返回已有纹理
+  */
+  std::shared_ptr<GLTexture> acquireEncoded(const std::string& key,
+                                            std::shared_ptr<const std::vector<uint8_t>> encoded) {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::shared_ptr<GLTexture> texture = textures[key].lock();
+    if (!texture) {
+      std::shared_ptr<InterpolateGLTexture> t =
+          InterpolateGLTexture::loadEncoded(key, std::move(encoded), ThreadPool::shared(), true, format);
+      if (policy == GLTextureLoadPolicy::EAGER) t->request();
+      texture = t;
+      textures[key] = texture;
+    }
+    return texture;
+  }
+
+  // 阻塞直到所有已提交的纹理解码完成, 供需要完整纹理的离线渲染 / 测试使用
+  void waitAll() { ThreadPool::shared().wait(); }
+
+  // 当前仍被引用的纹理数量
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mtx);
+    size_t n = 0;
+    for (auto& t : textures) {
+      if (!t.second.expired()) ++n;
+    }
+    return n;
+  }
+
+  // 清理已释放纹理的键
+  void purge() {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto it = textures.begin(); it != textures.end();) {
+      if (it->second.expired()) {
+        it = textures.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+};
+
+}  // namespace qtgl
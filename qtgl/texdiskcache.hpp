@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mappedfile.hpp"
+#include "texstorage.hpp"
+
+namespace qtgl {
+
+/*
+预处理纹理的磁盘缓存
+  - 缓存文件保存已转换、生成 mip 链并重排 (及压缩) 好的纹素, 加载时直接内存映射使用, 不再解码图像
+  - 文件名由源图像路径与纹素格式决定; 文件头记录源文件的大小、修改时间与内容哈希,
+    任意一项不符即视为失效, 重新解码后覆盖
+  - 写入先落到临时文件再改名, 并发加载同一纹理或进程中途退出都不会留下不完整的缓存
+
+文件布局 (小端, 与本机内存布局一致):
+  Header | Level[levelCount] | 各层纹素, 每层起始位置按 ALIGNMENT 对齐
+*/
+class GLTextureDiskCache {
+ private:
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t format;
+    uint32_t pot;
+    uint32_t levelCount;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t sourceHash;
+  };
+  struct Level {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t words;
+  };
+
+  std::mutex mtx;
+  std::string directory;
+
+  GLTextureDiskCache() {
+    std::error_code ec;
+    std::filesystem::path tmp = std::filesystem::temp_directory_path(ec);
+    if (!ec) directory = (tmp / "qtgl_texture_cache").string();
+  }
+
+  static uint64_t fnv1a(const void* data, size_t size, uint64_t h = 14695981039346656037ull) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+      h ^= p[i];
+      h *= 1099511628211ull;
+    }
+    return h;
+  }
+
+  // 源文件的大小、修改时间与内容哈希, 源文件不可读时返回 false
+  static bool fingerprint(const std::string& source, Header& h) {
+    std::error_code ec;
+    std::filesystem::file_time_type mtime = std::filesystem::last_write_time(source, ec);
+    if (ec) return false;
+    std::shared_ptr<MappedFile> file = MappedFile::open(source);
+    if (!file) return false;
+    h.sourceSize = file->size();
+    h.sourceMtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    h.sourceHash = fnv1a(file->data(), file->size());
+    return true;
+  }
+
+  static Header makeHeader(GLTexelFormat format, bool pot, uint32_t levelCount) {
+    Header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, MAGIC, sizeof(h.magic));
+    h.version = VERSION;
+    h.format = static_cast<uint32_t>(format);
+    h.pot = pot ? 1 : 0;
+    h.levelCount = levelCount;
+    return h;
+  }
+
+  static uint64_t align(uint64_t offset) { return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+ public:
+  constexpr static char MAGIC[8] = {'Q', 'T', 'G', 'L', 'T', 'E', 'X', '\0'};
+  constexpr static uint32_t VERSION = 1;
+  constexpr static uint64_t ALIGNMENT = 64;
+
+  GLTextureDiskCache(const GLTextureDiskCache&) = delete;
+  GLTextureDiskCache& operator=(const GLTextureDiskCache&) = delete;
+
+  static GLTextureDiskCache& instance() {
+    static GLTextureDiskCache cache;
+    return cache;
+  }
+
+  // 设置缓存目录, 空字符串表示禁用磁盘缓存
+  void setDirectory(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(mtx);
+    directory = dir;
+  }
+  std::string getDirectory() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return directory;
+  }
+
+  // 源图像对应的缓存文件路径, 禁用时返回空
+  std::string cachePath(const std::string& source, bool pot, GLTexelFormat format) {
+    std::string dir = getDirectory();
+    if (dir.empty()) return "";
+    uint64_t h = fnv1a(source.data(), source.size());
+    uint32_t tag[2] = {static_cast<uint32_t>(format), pot ? 1u : 0u};
+    h = fnv1a(tag, sizeof(tag), h);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.qtex", static_cast<unsigned long long>(h));
+    return (std::filesystem::path(dir) / name).string();
+  }
+
+  /*
+  读取缓存, 各层直接引用映射的文件内容, 文件在最后一层释放后解除映射
+  缓存不存在或已失效时返回空
+  */
+  std::vector<SwizzledTexels> load(const std::string& source, bool pot, GLTexelFormat format) {
+    std::string path = cachePath(source, pot, format);
+    if (path.empty()) return {};
+    std::shared_ptr<MappedFile> file = MappedFile::open(path);
+    if (!file || file->size() < sizeof(Header)) return {};
+
+    Header h;
+    std::memcpy(&h, file->data(), sizeof(h));
+    Header expected = makeHeader(format, pot, h.levelCount);
+    if (std::memcmp(h.magic, expected.magic, sizeof(h.magic)) != 0 || h.version != VERSION ||
+        h.format != expected.format || h.pot != expected.pot || h.levelCount == 0) {
+      return {};
+    }
+    if (!fingerprint(source, expected) || h.sourceSize != expected.sourceSize ||
+        h.sourceMtime != expected.sourceMtime || h.sourceHash != expected.sourceHash) {
+      return {};
+    }
+    if (file->size() < sizeof(Header) + h.levelCount * sizeof(Level)) return {};
+
+    std::vector<SwizzledTexels> levels;
+    levels.reserve(h.levelCount);
+    const uint8_t* table = file->data() + sizeof(Header);
+    for (uint32_t i = 0; i < h.levelCount; ++i) {
+      Level l;
+      std::memcpy(&l, table + i * sizeof(Level), sizeof(l));
+      if (l.width == 0 || l.height == 0 || l.offset % ALIGNMENT != 0 ||
+          l.words != SwizzledTexels::storageWords(l.width, l.height, format) ||
+          l.offset + l.words * sizeof(uint32_t) > file->size()) {
+        return {};
+      }
+      const uint32_t* words = reinterpret_cast<const uint32_t*>(file->data() + l.offset);
+      levels.emplace_back(l.width, l.height, format, words, file);
+    }
+    return levels;
+  }
+
+  // 写入缓存, 失败时静默放弃 (下次启动重新解码)
+  void store(const std::string& source, bool pot, GLTexelFormat format,
+             const std::vector<SwizzledTexels>& levels) {
+    std::string path = cachePath(source, pot, format);
+    if (path.empty() || levels.empty()) return;
+    Header h = makeHeader(format, pot, static_cast<uint32_t>(levels.size()));
+    if (!fingerprint(source, h)) return;
+
+    std::vector<Level> table(levels.size());
+    uint64_t offset = align(sizeof(Header) + table.size() * sizeof(Level));
+    for (size_t i = 0; i < levels.size(); ++i) {
+      table[i].width = static_cast<uint32_t>(levels[i].getWidth());
+      table[i].height = static_cast<uint32_t>(levels[i].getHeight());
+      table[i].offset = offset;
+      table[i].words = levels[i].byteSize() / sizeof(uint32_t);
+      offset = align(offset + levels[i].byteSize());
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    std::string tmp =
+        path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+        ".tmp";
+    {
+      std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+      if (!out) return;
+      out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+      out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Level));
+      const char zeros[ALIGNMENT] = {};
+      for (size_t i = 0; i < levels.size(); ++i) {
+        uint64_t pos = static_cast<uint64_t>(out.tellp());
+        out.write(zeros, static_cast<std::streamsize>(table[i].offset - pos));
+        out.write(reinterpret_cast<const char*>(levels[i].data()),
+                  static_cast<std::streamsize>(levels[i].byteSize()));
+      }
+      if (!out) {
+        out.close();
+        std::filesystem::remove(tmp, ec);
+        return;
+      }
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) std::filesystem::remove(tmp, ec);
+  }
+};
+
+}  // namespace qtgl
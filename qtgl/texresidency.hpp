@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace qtgl {
+
+/*
+可被驻留管理器驱逐的纹理, 以 mip 层为单位管理
+以下方法只在渲染线程调用
+*/
+class GLResidentTexture {
+ public:
+  virtual ~GLResidentTexture() = default;
+  virtual int levelCount() const = 0;
+  virtual size_t levelBytes(int level) const = 0;
+  virtual bool isLevelResident(int level) const = 0;
+  virtual uint64_t levelLastUsed(int level) const = 0;
+  virtual void evictLevel(int level) = 0;
+};
+
+struct GLTextureResidencyStats {
+  size_t budgetBytes = 0;
+  size_t residentBytes = 0;   // 当前驻留的纹素字节数
+  size_t requestedBytes = 0;  // 已解码纹理完整 mip 链的字节数, 即不受预算限制时的驻留量
+  size_t pinnedBytes = 0;     // 常驻的粗糙层字节数
+  int textures = 0;           // 已注册纹理数
+  int decodes = 0;            // 累计解码次数, 包括驱逐后的重新解码
+  int evictions = 0;          // 累计驱逐的 mip 层数
+};
+
+/*
+纹理驻留管理器
+  - 纹理在首次采样时才解码
+  - 单层不超过 PINNED_LEVEL_BYTES 的粗糙 mip 层常驻, 保证任何时候都有可采样的层
+  - 每帧结束时若驻留字节数超出预算, 按最近使用帧号从旧到新驱逐精细层;
+    当前帧用到的层不驱逐. 被驱逐的层再次被采样时先退回到更粗糙的驻留层, 并在后台重新解码
+*/
+class GLTextureResidency {
+ private:
+  std::mutex mtx;
+  std::set<GLResidentTexture*> textures;
+  size_t budget = 512u << 20;
+  std::atomic<int64_t> residentBytes{0};
+  std::atomic<int64_t> requestedBytes{0};
+  std::atomic<int> decodes{0};
+  std::atomic<int> evictions{0};
+  std::atomic<uint64_t> frame{1};
+  uint64_t samples = 0;  // 只在渲染线程访问
+
+  GLTextureResidency() = default;
+
+ public:
+  constexpr static size_t PINNED_LEVEL_BYTES = 64 * 64 * 4;
+
+  GLTextureResidency(const GLTextureResidency&) = delete;
+  GLTextureResidency& operator=(const GLTextureResidency&) = delete;
+
+  static GLTextureResidency& instance() {
+    static GLTextureResidency residency;
+    return residency;
+  }
+
+  void setBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mtx);
+    budget = bytes;
+  }
+  size_t getBudget() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return budget;
+  }
+
+  static bool isPinned(size_t levelBytes) { return levelBytes <= PINNED_LEVEL_BYTES; }
+
+  uint64_t currentFrame() const { return frame.load(std::memory_order_relaxed); }
+
+  void registerTexture(GLResidentTexture* t) {
+    std::lock_guard<std::mutex> lock(mtx);
+    textures.insert(t);
+  }
+  void unregisterTexture(GLResidentTexture* t) {
+    std::lock_guard<std::mutex> lock(mtx);
+    textures.erase(t);
+  }
+
+  void onResident(int64_t bytes) { residentBytes += bytes; }
+  void onRequested(int64_t bytes) { requestedBytes += bytes; }
+  void onDecode() { ++decodes; }
+  // 渲染线程每读取一次 mip 层计数一次, 用于帧统计
+  void onSample() { ++samples; }
+  uint64_t sampleCount() const { return samples; }
+
+  /*
+  帧结束时由渲染线程调用: 推进帧号, 超出预算时驱逐最久未用的精细层
+  */
+  void endFrame() {
+    uint64_t now = frame.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mtx);
+    if (residentBytes.load() <= static_cast<int64_t>(budget)) return;
+
+    struct Candidate {
+      uint64_t lastUsed;
+      GLResidentTexture* texture;
+      int level;
+    };
+    std::vector<Candidate> candidates;
+    for (GLResidentTexture* t : textures) {
+      for (int l = 0; l < t->levelCount(); ++l) {
+        if (t->isLevelResident(l) && !isPinned(t->levelBytes(l)) && t->levelLastUsed(l) < now) {
+          candidates.push_back({t->levelLastUsed(l), t, l});
+        }
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& a, const Candidate& b) { return a.lastUsed < b.lastUsed; });
+    for (Candidate& c : candidates) {
+      if (residentBytes.load() <= static_cast<int64_t>(budget)) break;
+      c.texture->evictLevel(c.level);
+      ++evictions;
+    }
+  }
+
+  GLTextureResidencyStats stats() {
+    std::lock_guard<std::mutex> lock(mtx);
+    GLTextureResidencyStats s;
+    s.budgetBytes = budget;
+    s.residentBytes = static_cast<size_t>(std::max<int64_t>(0, residentBytes.load()));
+    s.requestedBytes = static_cast<size_t>(std::max<int64_t>(0, requestedBytes.load()));
+    s.textures = static_cast<int>(textures.size());
+    s.decodes = decodes.load();
+    s.evictions = evictions.load();
+    for (GLResidentTexture* t : textures) {
+      for (int l = 0; l < t->levelCount(); ++l) {
+        if (t->isLevelResident(l) && isPinned(t->levelBytes(l))) s.pinnedBytes += t->levelBytes(l);
+      }
+    }
+    return s;
+  }
+};
+
+}  // namespace qtgl
@@ -0,0 +1,344 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <vector>
+#include "define.hpp"
+
+namespace qtgl {
+
+/*
+RGBA8 纹素, R 位于最低字节
+*/
+struct Texel {
+  inline static uint32_t pack(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    return static_cast<uint32_t>(r) | (static_cast<uint32_t>(g) << 8) |
+           (static_cast<uint32_t>(b) << 16) | (static_cast<uint32_t>(a) << 24);
+  }
+  inline static Color01 unpack(uint32_t t) {
+    constexpr double k = 1.0 / 255;
+    return Color01((t & 0xff) * k, ((t >> 8) & 0xff) * k, ((t >> 16) & 0xff) * k, (t >> 24) * k);
+  }
+};
+
+enum class GLTexelFormat {
+  RGBA8,  // 4 字节 / 纹素
+  BC1     // 4x4 块压缩, 8 字节 / 块即 0.5 字节 / 纹素, 不含 alpha
+};
+
+/*
+BC1 (DXT1) 块: word0 = 两个 RGB565 端点 c0 | c1 << 16, word1 = 16 个 2 位索引, 第 i 个纹素位于 2i 位
+始终使用 c0 > c1 的四色模式, 调色板为 c0, c1, (2c0 + c1) / 3, (c0 + 2c1) / 3
+REF: https://learn.microsoft.com/en-us/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression#bc1
+*/
+struct BC1Block {
+  inline static uint16_t to565(int r, int g, int b) {
+    return static_cast<uint16_t>(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 |
+                                 ((b * 31 + 127) / 255));
+  }
+  inline static void from565(uint32_t c, int& r, int& g, int& b) {
+    r = ((c >> 11) & 31) * 255 / 31;
+    g = ((c >> 5) & 63) * 255 / 63;
+    b = (c & 31) * 255 / 31;
+  }
+
+  // texel 为 16 个 RGBA8 纹素 (行优先), 输出两个 word
+  static void encode(const uint32_t* texel, uint32_t* block) {
+    int lo[3] = {255, 255, 255};
+    int hi[3] = {0, 0, 0};
+    for (int i = 0; i < 16; ++i) {
+      for (int c = 0; c < 3; ++c) {
+        int v = (texel[i] >> (8 * c)) & 0xff;
+        lo[c] = std::min(lo[c], v);
+        hi[c] = std::max(hi[c], v);
+      }
+    }
+    // 端点向内收缩 1/16, 减小包围盒对角线两端离群值的影响
+    for (int c = 0; c < 3; ++c) {
+      int inset = (hi[c] - lo[c]) >> 4;
+      lo[c] += inset;
+      hi[c] -= inset;
+    }
+    uint16_t c0 = to565(hi[0], hi[1], hi[2]);
+    uint16_t c1 = to565(lo[0], lo[1], lo[2]);
+    block[0] = c0 | (static_cast<uint32_t>(c1) << 16);
+    block[1] = 0;
+    if (c0 == c1) return;  // 单色块, 全部使用索引 0
+
+    int palette[4][3];
+    from565(c0, palette[0][0], palette[0][1], palette[0][2]);
+    from565(c1, palette[1][0], palette[1][1], palette[1][2]);
+    for (int c = 0; c < 3; ++c) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    for (int i = 0; i < 16; ++i) {
+      int best = 0;
+      int bestDist = std::numeric_limits<int>::max();
+      for (int k = 0; k < 4; ++k) {
+        int dist = 0;
+        for (int c = 0; c < 3; ++c) {
+          int d = static_cast<int>((texel[i] >> (8 * c)) & 0xff) - palette[k][c];
+          dist += d * d;
+        }
+        if (dist < bestDist) {
+          bestDist = dist;
+          best = k;
+        }
+      }
+      block[1] |= static_cast<uint32_t>(best) << (2 * i);
+    }
+  }
+
+  // 解码块内第 i 个纹素为 RGBA8
+  inline static uint32_t decode(const uint32_t* block, int i) {
+    int idx = (block[1] >> (2 * i)) & 3;
+    int r0, g0, b0, r1, g1, b1;
+    from565(block[0] & 0xffff, r0, g0, b0);
+    from565(block[0] >> 16, r1, g1, b1);
+    switch (idx) {
+      case 0:
+        return Texel::pack(r0, g0, b0, 255);
+      case 1:
+        return Texel::pack(r1, g1, b1, 255);
+      case 2:
+        return Texel::pack((2 * r0 + r1) / 3, (2 * g0 + g1) / 3, (2 * b0 + b1) / 3, 255);
+      default:
+        return Texel::pack((r0 + 2 * r1) / 3, (g0 + 2 * g1) / 3, (b0 + 2 * b1) / 3, 255);
+    }
+  }
+};
+
+/*
+按 Morton (Z 序) 排列的纹素
+  - 2D 上相邻的纹素在内存中也相邻, 双线性插值的 2x2 足迹通常落在同一条缓存行内
+  - 存储区的长宽向上取整为 2 的幂; 若纹理本身长宽均为 2 的幂, 环绕寻址只需按位与
+  - Morton 序在 x / y 上可分离: index = xoffsets[x] + yoffsets[y], 两张表替代逐位交错
+非正方形时, 先交错两者共有的低位, 较长一边多出的高位依次排在最高位
+BC1 格式下 Morton 序作用于 4x4 块, 偏移表给出纹素所在块的起始 word, 取纹素时解码该块
+纹素数据不可变, 由 owner 持有 (自有缓冲区或内存映射文件), 拷贝时共享
+*/
+class SwizzledTexels {
+ private:
+  int width = 0;   // 纹理长宽
+  int height = 0;
+  bool pot = false;  // 长宽是否均为 2 的幂
+  int maskX = 0;
+  int maskY = 0;
+  GLTexelFormat format = GLTexelFormat::RGBA8;
+  size_t storageBytes = 0;
+  std::vector<uint32_t> xoffsets;
+  std::vector<uint32_t> yoffsets;
+  const uint32_t* texels = nullptr;
+  std::shared_ptr<const void> owner;
+
+  static int ceilPowerOfTwo(int n) {
+    int p = 1;
+    while (p < n) p <<= 1;
+    return p;
+  }
+
+  static int log2i(int n) {
+    int l = 0;
+    while ((1 << l) < n) ++l;
+    return l;
+  }
+
+  /*
+  gw x gh 为 Morton 网格的单元数 (2 的幂), 坐标右移 shift 位得到单元坐标, 每个单元占 unit 个 word
+  */
+  void buildOffsets(int gw, int gh, int shift, int unit) {
+    int lw = log2i(gw);
+    int lh = log2i(gh);
+    int common = std::min(lw, lh);
+    xoffsets.assign(width, 0);
+    yoffsets.assign(height, 0);
+    for (int x = 0; x < width; ++x) {
+      int cx = x >> shift;
+      uint32_t o = 0;
+      for (int b = 0; b < common; ++b) o |= ((cx >> b) & 1u) << (2 * b);
+      o |= static_cast<uint32_t>(cx >> common) << (2 * common);
+      xoffsets[x] = o * unit;
+    }
+    for (int y = 0; y < height; ++y) {
+      int cy = y >> shift;
+      uint32_t o = 0;
+      for (int b = 0; b < common; ++b) o |= ((cy >> b) & 1u) << (2 * b + 1);
+      // 只有较长一边存在高位, 两者不会同时落到 2 * common 之上
+      o |= static_cast<uint32_t>(cy >> common) << (2 * common);
+      yoffsets[y] = o * unit;
+    }
+  }
+
+  // 由长宽及格式确定寻址方式, 返回存储所需的 word 数
+  size_t layout(int width, int height, GLTexelFormat format) {
+    this->width = width;
+    this->height = height;
+    this->format = format;
+    int pw = ceilPowerOfTwo(width);
+    int ph = ceilPowerOfTwo(height);
+    pot = width == pw && height == ph;
+    maskX = pw - 1;
+    maskY = ph - 1;
+    size_t words;
+    if (format == GLTexelFormat::RGBA8) {
+      buildOffsets(pw, ph, 0, 1);
+      words = static_cast<size_t>(pw) * ph;
+    } else {
+      int bw = std::max(1, pw / 4);
+      int bh = std::max(1, ph / 4);
+      buildOffsets(bw, bh, 2, 2);
+      words = static_cast<size_t>(bw) * bh * 2;
+    }
+    storageBytes = words * sizeof(uint32_t);
+    return words;
+  }
+
+  static uint32_t readTexel(const cv::Mat& img, int x, int y) {
+    if (img.channels() == 4) {
+      const cv::Vec4b& v = img.at<cv::Vec4b>(y, x);
+      return Texel::pack(v[2], v[1], v[0], v[3]);
+    }
+    const cv::Vec3b& v = img.at<cv::Vec3b>(y, x);
+    return Texel::pack(v[2], v[1], v[0], 255);
+  }
+
+ public:
+  SwizzledTexels() = default;
+
+  /*
+  由 cv::imread 得到的 BGR8 (或 BGRA8) 图像构造
+  resizeToPowerOfTwo 为 true 时先将图像重采样到向上取整的 2 的幂, 使环绕寻址只需按位与;
+  否则保留原尺寸, 环绕时取模
+  format 为 BC1 时在此处完成压缩
+  */
+  SwizzledTexels(const cv::Mat& bgr, bool resizeToPowerOfTwo,
+                 GLTexelFormat format = GLTexelFormat::RGBA8) {
+    cv::Mat img = bgr;
+    int pw = ceilPowerOfTwo(bgr.cols);
+    int ph = ceilPowerOfTwo(bgr.rows);
+    if (resizeToPowerOfTwo && (pw != bgr.cols || ph != bgr.rows)) {
+      cv::resize(bgr, img, cv::Size(pw, ph), 0, 0, cv::INTER_LINEAR);
+    }
+    std::shared_ptr<std::vector<uint32_t>> storage =
+        std::make_shared<std::vector<uint32_t>>(layout(img.cols, img.rows, format), 0);
+    std::vector<uint32_t>& words = *storage;
+
+    if (format == GLTexelFormat::RGBA8) {
+      for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+          words[xoffsets[x] + yoffsets[y]] = readTexel(img, x, y);
+        }
+      }
+    } else {
+      uint32_t block[16];
+      for (int by = 0; by * 4 < height; ++by) {
+        for (int bx = 0; bx * 4 < width; ++bx) {
+          // 超出图像的纹素复制边缘
+          for (int i = 0; i < 16; ++i) {
+            int x = std::min(bx * 4 + (i & 3), width - 1);
+            int y = std::min(by * 4 + (i >> 2), height - 1);
+            block[i] = readTexel(img, x, y);
+          }
+          BC1Block::encode(block, &words[xoffsets[bx * 4] + yoffsets[by * 4]]);
+        }
+      }
+    }
+    texels = storage->data();
+    owner = storage;
+  }
+
+  /*
+  直接使用外部已按本类布局排列好的纹素 (如内存映射的磁盘缓存), 不拷贝
+  words 至少包含 storageWords(width, height, format) 个 word, owner 保证其生命周期
+  */
+  SwizzledTexels(int width, int height, GLTexelFormat format, const uint32_t* words,
+                 std::shared_ptr<const void> owner) {
+    layout(width, height, format);
+    this->texels = words;
+    this->owner = owner;
+  }
+
+  static size_t storageWords(int width, int height, GLTexelFormat format) {
+    SwizzledTexels t;
+    return t.layout(width, height, format);
+  }
+
+  // 纹素数据的起始地址, 用于序列化
+  const uint32_t* data() const { return texels; }
+
+  int getWidth() const { return width; }
+  int getHeight() const { return height; }
+  bool isPowerOfTwo() const { return pot; }
+  GLTexelFormat getFormat() const { return format; }
+  // 纹素存储字节数, 不论当前是否驻留
+  size_t byteSize() const { return storageBytes; }
+  bool isResident() const { return texels != nullptr; }
+  // 释放纹素, 保留尺寸信息
+  void release() {
+    texels = nullptr;
+    owner.reset();
+  }
+
+  inline int wrapX(int x) const {
+    if (pot) return x & maskX;
+    x %= width;
+    return x < 0 ? x + width : x;
+  }
+  inline int wrapY(int y) const {
+    if (pot) return y & maskY;
+    y %= height;
+    return y < 0 ? y + height : y;
+  }
+
+  // (x, y) 已在范围内, 返回 RGBA8
+  inline uint32_t at(int x, int y) const {
+    const uint32_t* p = &texels[xoffsets[x] + yoffsets[y]];
+    if (format == GLTexelFormat::RGBA8) return *p;
+    return BC1Block::decode(p, ((y & 3) << 2) | (x & 3));
+  }
+
+  // 任意整数坐标, 重复环绕
+  inline uint32_t fetch(int x, int y) const { return at(wrapX(x), wrapY(y)); }
+
+  // 一次取 4 / 8 个纹素, 坐标先统一环绕再查表, 便于编译器展开与向量化
+  void fetch4(const int* x, const int* y, uint32_t* out) const {
+    int wx[4], wy[4];
+    for (int k = 0; k < 4; ++k) {
+      wx[k] = wrapX(x[k]);
+      wy[k] = wrapY(y[k]);
+    }
+    for (int k = 0; k < 4; ++k) out[k] = at(wx[k], wy[k]);
+  }
+  void fetch8(const int* x, const int* y, uint32_t* out) const {
+    fetch4(x, y, out);
+    fetch4(x + 4, y + 4, out + 4);
+  }
+
+  // 取以 (x, y) 为左上角的 2x2 足迹: out = {(x, y), (x+1, y), (x, y+1), (x+1, y+1)}
+  inline void fetch2x2(int x, int y, uint32_t* out) const {
+    int x0 = wrapX(x);
+    int x1 = wrapX(x + 1);
+    int y0 = wrapY(y);
+    int y1 = wrapY(y + 1);
+    if (format != GLTexelFormat::RGBA8) {
+      out[0] = at(x0, y0);
+      out[1] = at(x1, y0);
+      out[2] = at(x0, y1);
+      out[3] = at(x1, y1);
+      return;
+    }
+    uint32_t oy0 = yoffsets[y0];
+    uint32_t oy1 = yoffsets[y1];
+    out[0] = texels[xoffsets[x0] + oy0];
+    out[1] = texels[xoffsets[x1] + oy0];
+    out[2] = texels[xoffsets[x0] + oy1];
+    out[3] = texels[xoffsets[x1] + oy1];
+  }
+};
+
+}  // namespace qtgl
@@ -1,17 +1,51 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <opencv2/core.hpp>
 #include <opencv2/core/eigen.hpp>
 #include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <vector>
 #include "define.hpp"
+#include "texdiskcache.hpp"
+#include "texresidency.hpp"
+#include "texstorage.hpp"
+#include "threadpool.hpp"
 
 namespace qtgl {
 
+/*
+纹理坐标在屏幕空间 x / y 方向上的偏导数
+由 2x2 像素块内相邻像素的纹理坐标差分得到, 用于选择 mip 层级
+*/
+struct TexCoordDerivs {
+  TexCoord dx;
+  TexCoord dy;
+};
+
+enum class GLTextureFilter {
+  NEAREST,   // 最近邻, 仅使用第 0 层
+  BILINEAR,  // 在最接近的 mip 层上双线性插值
+  TRILINEAR  // 在相邻两个 mip 层上双线性插值后再线性混合
+};
+
 class GLTexture {
  public:
   GLTexture() = default;
   virtual ~GLTexture() = default;
   virtual Color01 sample(TexCoord& coord) = 0;
+  // 带导数的采样, 默认忽略导数
+  virtual Color01 sample(TexCoord& coord, TexCoordDerivs& /*derivs*/) { return sample(coord); }
+  // 异步加载的纹理在解码完成前返回 false, 此时调用方应使用占位颜色
+  virtual bool isReady() const { return true; }
+  // 采样前调用: 安装已完成的解码结果, 尚未解码时发起解码; 返回是否可采样
+  virtual bool request() { return isReady(); }
+  // 纹理来源 (图像文件路径), 用于序列化; 非文件纹理返回空
+  virtual std::string getSource() const { return ""; }
 
   static TexCoord interpolateTexCoord(Triangle2& t, double alpha, double beta, double gamma) {
     return prespectiveCorrectInterpolate(t, alpha, beta, gamma);
@@ -42,29 +76,302 @@ class GLTexture {
   }
 };
 
-class InterpolateGLTexture : public GLTexture {
- public:
-  cv::Mat mat;
-  InterpolateGLTexture() = default;
-  ~InterpolateGLTexture() = default;
-  InterpolateGLTexture(std::string mapref) {
+/*
+纹理由 GLTextureResidency 管理驻留:
+  - 异步纹理在首次 request() / 采样时才提交解码, 解码结果在渲染线程下一次访问时安装
+  - 精细 mip 层可被驱逐, 再次需要时退回到更粗糙的驻留层并在后台重新解码
+levels / lastUsed / installed / decoding 只在渲染线程读写; 解码线程只写 pending
+*/
+class InterpolateGLTexture : public GLTexture,
+                             public GLResidentTexture,
+                             public std::enable_shared_from_this<InterpolateGLTexture> {
+ private:
+  std::string mapref;
+  // 内嵌图像 (如 .glb 中的 PNG / JPEG) 的编码数据, 非空时从此解码而不读取 mapref 文件
+  std::shared_ptr<const std::vector<uint8_t>> encoded;
+  bool resizeToPowerOfTwo = true;
+  GLTexelFormat format = GLTexelFormat::RGBA8;
+  ThreadPool* pool = nullptr;  // 为空时同步解码
+  // mip 链, levels[0] 为原图, 逐层长宽减半直至 1x1; 纹素为 Morton 序 RGBA8, 见 texstorage.hpp
+  std::vector<SwizzledTexels> levels;
+  std::vector<uint64_t> lastUsed;  // 每层最近一次被采样的帧号
+  GLTextureFilter filter = GLTextureFilter::TRILINEAR;
+  bool installed = false;  // levels 是否可用
+  bool decoding = false;   // 已提交解码, 结果尚未安装
+  bool failed = false;     // 首次解码失败, 不再重试
+  // 自上次安装以来被采样但未驻留的最精细层; 重新解码后只装回该层及更粗糙的层
+  size_t requestedLevel = std::numeric_limits<size_t>::max();
+
+  std::mutex pendingMtx;
+  std::vector<SwizzledTexels> pending;  // 解码线程的输出
+  std::atomic<bool> pendingReady{false};
+
+  /*
+  渲染线程: 将 pending 中的层装入 levels, 已驻留的层保持不变;
+  重新解码时只装回 requestedLevel 及更粗糙的层, 其余丢弃, 避免装回未被使用的精细层后超出预算、
+  在 endFrame 中再次被驱逐而每帧重新解码
+  */
+  void install() {
+    std::vector<SwizzledTexels> decoded;
+    {
+      std::lock_guard<std::mutex> lock(pendingMtx);
+      decoded.swap(pending);
+      pendingReady.store(false, std::memory_order_relaxed);
+    }
+    decoding = false;
+    GLTextureResidency& residency = GLTextureResidency::instance();
+    if (levels.empty()) {
+      levels = std::move(decoded);
+      lastUsed.assign(levels.size(), 0);
+      int64_t bytes = 0;
+      for (SwizzledTexels& l : levels) bytes += l.byteSize();
+      residency.onResident(bytes);
+      residency.onRequested(bytes);
+    } else if (decoded.size() == levels.size()) {
+      for (size_t i = requestedLevel; i < levels.size(); ++i) {
+        if (!levels[i].isResident()) {
+          levels[i] = std::move(decoded[i]);
+          residency.onResident(levels[i].byteSize());
+        }
+      }
+    }
+    requestedLevel = std::numeric_limits<size_t>::max();
+    installed = !levels.empty();
+    failed = !installed;
+  }
+
+  // 渲染线程: 提交 (重新) 解码
+  void startDecode() {
+    if (decoding) return;
+    decoding = true;
+    GLTextureResidency::instance().onDecode();
+    if (pool == nullptr) {
+      pending = decode(mapref, encoded, resizeToPowerOfTwo, format);
+      install();
+      return;
+    }
+    std::weak_ptr<InterpolateGLTexture> self = weak_from_this();
+    std::string path = mapref;
+    std::shared_ptr<const std::vector<uint8_t>> data = encoded;
+    bool pot = resizeToPowerOfTwo;
+    GLTexelFormat fmt = format;
+    pool->submit([self, path, data, pot, fmt]() {
+      std::vector<SwizzledTexels> decoded = decode(path, data, pot, fmt);
+      std::shared_ptr<InterpolateGLTexture> texture = self.lock();
+      if (!texture) return;
+      std::lock_guard<std::mutex> lock(texture->pendingMtx);
+      texture->pending = std::move(decoded);
+      texture->pendingReady.store(true, std::memory_order_release);
+    });
+  }
+
+  // 渲染线程: 取第 level 层, 未驻留时退回到更粗糙的驻留层并发起重新解码
+  const SwizzledTexels& use(int level) {
+    GLTextureResidency& residency = GLTextureResidency::instance();
+    uint64_t now = residency.currentFrame();
+    residency.onSample();
+    int l = level;
+    while (l + 1 < static_cast<int>(levels.size()) && !levels[l].isResident()) ++l;
+    if (l != level) {
+      requestedLevel = std::min(requestedLevel, static_cast<size_t>(level));
+      startDecode();
+    }
+    lastUsed[l] = now;
+    return levels[l];
+  }
+
+  static std::vector<SwizzledTexels> buildMipChain(cv::Mat img, bool resizeToPowerOfTwo,
+                                                   GLTexelFormat format) {
+    std::vector<SwizzledTexels> levels;
+    levels.emplace_back(img, resizeToPowerOfTwo, format);
+    if (levels.back().getWidth() != img.cols || levels.back().getHeight() != img.rows) {
+      cv::Mat resized;
+      cv::resize(img, resized, cv::Size(levels.back().getWidth(), levels.back().getHeight()), 0,
+                 0, cv::INTER_LINEAR);
+      img = resized;
+    }
+    while (img.rows > 1 || img.cols > 1) {
+      cv::Mat next;
+      cv::resize(img, next, cv::Size(std::max(1, img.cols / 2), std::max(1, img.rows / 2)), 0, 0,
+                 cv::INTER_AREA);
+      levels.emplace_back(next, false, format);
+      img = next;
+    }
+    return levels;
+  }
+
+  /*
+  解码图像并生成 mip 链 (BC1 格式时同时完成压缩), 失败时返回空
+  图像文件优先映射磁盘缓存中的预处理结果, 未命中时解码并写回缓存; 内嵌图像直接解码
+  */
+  static std::vector<SwizzledTexels> decode(const std::string& mapref,
+                                            const std::shared_ptr<const std::vector<uint8_t>>& encoded,
+                                            bool resizeToPowerOfTwo, GLTexelFormat format) {
+    if (encoded) {
+      cv::Mat img = cv::imdecode(*encoded, cv::IMREAD_COLOR);
+      if (img.empty()) {
+        std::cerr << "Error: cannot decode image " << mapref << std::endl;
+        return {};
+      }
+      return buildMipChain(img, resizeToPowerOfTwo, format);
+    }
+    GLTextureDiskCache& diskCache = GLTextureDiskCache::instance();
+    std::vector<SwizzledTexels> levels = diskCache.load(mapref, resizeToPowerOfTwo, format);
+    if (!levels.empty()) return levels;
     cv::Mat img = cv::imread(mapref);
     if (img.empty()) {
       std::cerr << "Error: cannot load image " << mapref << std::endl;
-      return;
+      return {};
     }
-    this->mat = img;
+    levels = buildMipChain(img, resizeToPowerOfTwo, format);
+    diskCache.store(mapref, resizeToPowerOfTwo, format, levels);
+    return levels;
+  }
+
+  static Color01 sampleNearest(const SwizzledTexels& m, TexCoord& coord) {
+    int i = static_cast<int>(std::floor((1 - coord[1]) * m.getHeight()));
+    int j = static_cast<int>(std::floor(coord[0] * m.getWidth()));
+    return Texel::unpack(m.fetch(j, i));
+  }
+
+  // 纹素中心位于 (i + 0.5, j + 0.5), 超出 [0, 1] 的坐标按重复方式环绕
+  static Color01 sampleBilinear(const SwizzledTexels& m, TexCoord& coord) {
+    double y = (1 - coord[1]) * m.getHeight() - 0.5;
+    double x = coord[0] * m.getWidth() - 0.5;
+    double fy = std::floor(y);
+    double fx = std::floor(x);
+    double ty = y - fy;
+    double tx = x - fx;
+    uint32_t t[4];
+    m.fetch2x2(static_cast<int>(fx), static_cast<int>(fy), t);
+    Color01 c0 = (1 - tx) * Texel::unpack(t[0]) + tx * Texel::unpack(t[1]);
+    Color01 c1 = (1 - tx) * Texel::unpack(t[2]) + tx * Texel::unpack(t[3]);
+    return (1 - ty) * c0 + ty * c1;
+  }
+
+ public:
+  InterpolateGLTexture() { GLTextureResidency::instance().registerTexture(this); }
+  ~InterpolateGLTexture() {
+    GLTextureResidency& residency = GLTextureResidency::instance();
+    residency.unregisterTexture(this);
+    int64_t resident = 0, requested = 0;
+    for (SwizzledTexels& l : levels) {
+      requested += l.byteSize();
+      if (l.isResident()) resident += l.byteSize();
+    }
+    residency.onResident(-resident);
+    residency.onRequested(-requested);
+  }
+  /*
+  同步解码
+  resizeToPowerOfTwo: 是否将非 2 的幂的图像重采样为 2 的幂, 使环绕寻址只需按位与
+  format: 纹素存储格式, BC1 内存占用为 RGBA8 的 1/8
+  */
+  InterpolateGLTexture(std::string mapref, bool resizeToPowerOfTwo = true,
+                       GLTexelFormat format = GLTexelFormat::RGBA8)
+      : InterpolateGLTexture() {
+    this->mapref = mapref;
+    this->resizeToPowerOfTwo = resizeToPowerOfTwo;
+    this->format = format;
+    startDecode();
   };
 
-  // TODO 双线性插值
+  /*
+  返回尚未解码的纹理, 首次 request() / 采样时在线程池中解码; 解码完成前 isReady() 为 false
+  */
+  static std::shared_ptr<InterpolateGLTexture> loadLazy(
+      const std::string& mapref, ThreadPool& pool, bool resizeToPowerOfTwo = true,
+      GLTexelFormat format = GLTexelFormat::RGBA8) {
+    std::shared_ptr<InterpolateGLTexture> texture = std::make_shared<InterpolateGLTexture>();
+    texture->mapref = mapref;
+    texture->resizeToPowerOfTwo = resizeToPowerOfTwo;
+    texture->format = format;
+    texture->pool = &pool;
+    return texture;
+  }
+
+  // 从内存中的编码图像创建, key 仅用于标识 (如 "model.glb#image0"), 其余同 loadLazy
+  static std::shared_ptr<InterpolateGLTexture> loadEncoded(
+      const std::string& key, std::shared_ptr<const std::vector<uint8_t>> encoded, ThreadPool& pool,
+      bool resizeToPowerOfTwo = true, GLTexelFormat format = GLTexelFormat::RGBA8) {
+    std::shared_ptr<InterpolateGLTexture> texture =
+        loadLazy(key, pool, resizeToPowerOfTwo, format);
+    texture->encoded = std::move(encoded);
+    return texture;
+  }
+
+  // 立即在线程池中开始解码, 其余同 loadLazy
+  static std::shared_ptr<InterpolateGLTexture> loadAsync(
+      const std::string& mapref, ThreadPool& pool, bool resizeToPowerOfTwo = true,
+      GLTexelFormat format = GLTexelFormat::RGBA8) {
+    std::shared_ptr<InterpolateGLTexture> texture =
+        loadLazy(mapref, pool, resizeToPowerOfTwo, format);
+    texture->startDecode();
+    return texture;
+  }
+
+  bool isReady() const { return installed; }
+  std::string getSource() const { return mapref; }
+
+  bool request() {
+    if (pendingReady.load(std::memory_order_acquire)) install();
+    if (!installed && !failed) startDecode();
+    return installed;
+  }
+
+  // GLResidentTexture
+  int levelCount() const { return static_cast<int>(levels.size()); }
+  size_t levelBytes(int level) const { return levels[level].byteSize(); }
+  bool isLevelResident(int level) const { return levels[level].isResident(); }
+  uint64_t levelLastUsed(int level) const { return lastUsed[level]; }
+  void evictLevel(int level) {
+    if (!levels[level].isResident()) return;
+    GLTextureResidency::instance().onResident(-static_cast<int64_t>(levels[level].byteSize()));
+    levels[level].release();
+  }
+
+  const std::vector<SwizzledTexels>& getLevels() const { return levels; }
+  GLTextureFilter getFilter() const { return filter; }
+  void setFilter(GLTextureFilter filter) { this->filter = filter; }
+
+  /*
+  根据纹理坐标导数计算 LOD: log2 of 屏幕上一个像素在第 0 层覆盖的最大纹素跨度
+  REF: OpenGL 4.6 Specification 8.14.1 Scale Factor and Level of Detail
+  */
+  double lod(TexCoordDerivs& derivs) const {
+    if (!installed) return 0;
+    double w = levels[0].getWidth();
+    double h = levels[0].getHeight();
+    double lx = std::hypot(derivs.dx[0] * w, derivs.dx[1] * h);
+    double ly = std::hypot(derivs.dy[0] * w, derivs.dy[1] * h);
+    double rho = std::max(lx, ly);
+    if (!(rho > 1)) return 0;
+    return std::min(std::log2(rho), static_cast<double>(levels.size() - 1));
+  }
+
   Color01 sample(TexCoord& coord) {
-    int i = round(mat.rows - coord[1] * mat.rows);
-    int j = round(coord[0] * mat.cols);
-    i = MAX(0, i);  // TODO 临时添加
-    j = MAX(0, j);  // TODO 临时添加
-    cv::Vec3b v = mat.at<cv::Vec3b>(i % mat.rows, j % mat.cols);
-    Color01 c(v[0] / 255.0, v[1] / 255.0, v[2] / 255.0, 1);
-    return c;
+    if (!request()) return Color01(1, 1, 1, 1);
+    if (filter == GLTextureFilter::NEAREST) return sampleNearest(use(0), coord);
+    return sampleBilinear(use(0), coord);
+  }
+
+  Color01 sample(TexCoord& coord, TexCoordDerivs& derivs) {
+    if (!request()) return Color01(1, 1, 1, 1);
+    switch (filter) {
+      case GLTextureFilter::NEAREST:
+        return sampleNearest(use(0), coord);
+      case GLTextureFilter::BILINEAR:
+        return sampleBilinear(use(static_cast<int>(std::lround(lod(derivs)))), coord);
+      default: {
+        double l = lod(derivs);
+        int l0 = static_cast<int>(l);
+        int l1 = std::min(l0 + 1, static_cast<int>(levels.size()) - 1);
+        double t = l - l0;
+        Color01 c0 = sampleBilinear(use(l0), coord);
+        if (t <= 0 || l1 == l0) return c0;
+        return (1 - t) * c0 + t * sampleBilinear(use(l1), coord);
+      }
+    }
   }
 };
 
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace qtgl {
+
+/*
+固定大小的工作线程池, 用于纹理解码等加载期任务
+*/
+class ThreadPool {
+ private:
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex mtx;
+  std::condition_variable taskCond;  // 有新任务或线程池关闭
+  std::condition_variable idleCond;  // 所有任务完成
+  int running = 0;
+  bool stopping = false;
+
+  void work() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        taskCond.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty()) return;
+        task = std::move(tasks.front());
+        tasks.pop();
+        ++running;
+      }
+      task();
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        --running;
+        if (tasks.empty() && running == 0) idleCond.notify_all();
+      }
+    }
+  }
+
+ public:
+  explicit ThreadPool(int n = defaultThreadCount()) {
+    for (int i = 0; i < n; ++i) {
+      workers.emplace_back(&ThreadPool::work, this);
+    }
+  }
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      stopping = true;
+    }
+    taskCond.notify_all();
+    for (std::thread& t : workers) {
+      t.join();
+    }
+  }
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  static int defaultThreadCount() {
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+
+  // 进程共享的线程池
+  static ThreadPool& shared() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  int size() const { return static_cast<int>(workers.size()); }
+
+  void submit(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      tasks.push(std::move(task));
+    }
+    taskCond.notify_one();
+  }
+
+  /*
+  并行执行 fn(0) ... fn(n - 1), 返回时全部完成
+  工作线程与调用线程从共享计数器领取下标, 调用线程自己也参与执行,
+  因此可以在线程池任务中调用而不会死锁; 只等待本次提交的下标, 不等待线程池中的其他任务
+  */
+  void parallelFor(size_t n, std::function<void(size_t)> fn) {
+    if (n == 0) return;
+    struct Work {
+      std::function<void(size_t)> fn;
+      size_t n;
+      std::atomic<size_t> next{0};
+      std::mutex mtx;
+      std::condition_variable cond;
+      size_t done = 0;
+    };
+    std::shared_ptr<Work> work = std::make_shared<Work>();
+    work->fn = std::move(fn);
+    work->n = n;
+    // 调用返回后才开始执行的任务领不到下标, 直接退出
+    auto run = [work]() {
+      for (size_t i; (i = work->next++) < work->n;) {
+        work->fn(i);
+        std::lock_guard<std::mutex> lock(work->mtx);
+        if (++work->done == work->n) work->cond.notify_all();
+      }
+    };
+    for (size_t i = 1; i < std::min(n, workers.size() + 1); ++i) submit(run);
+    run();
+    std::unique_lock<std::mutex> lock(work->mtx);
+    work->cond.wait(lock, [&work] { return work->done == work->n; });
+  }
+
+  // 阻塞直到队列为空且没有正在执行的任务
+  void wait() {
+    std::unique_lock<std::mutex> lock(mtx);
+    idleCond.wait(lock, [this] { return tasks.empty() && running == 0; });
+  }
+};
+
+}  // namespace qtgl